@@ -0,0 +1,291 @@
+/**
+    Copyright 2026 Red Anchor Trading Co. Ltd.
+
+    Distributed under the Boost Software License, Version 1.0.
+    See <http://www.boost.org/LICENSE_1_0.txt>
+ */
+
+
+#pragma once
+
+
+#include <f5/threading/limiters.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include <utility>
+
+
+namespace f5 {
+
+
+    inline namespace threading {
+
+
+        namespace fd {
+
+
+            /// Additive increase, multiplicative decrease. The limit grows
+            /// by one for each sample taken while the limiter is being well
+            /// used, and is cut back by `backoff` whenever a job takes
+            /// longer than `timeout`.
+            class aimd {
+                const double backoff;
+                const std::chrono::steady_clock::duration timeout;
+
+              public:
+                aimd(std::chrono::steady_clock::duration timeout,
+                     double backoff = 0.9)
+                : backoff(backoff), timeout(timeout) {}
+
+                /// Return the new limit
+                double
+                        update(double limit,
+                               std::chrono::steady_clock::duration rtt,
+                               std::chrono::steady_clock::duration,
+                               uint64_t outstanding) {
+                    if (rtt > timeout) {
+                        return limit * backoff;
+                    } else if (outstanding * 2 >= limit) {
+                        return limit + 1;
+                    } else {
+                        return limit;
+                    }
+                }
+            };
+
+
+            /// Compares each job's latency with the lowest latency seen,
+            /// which is taken to be the latency without any queueing. While
+            /// the latency is within `tolerance` times the minimum the limit
+            /// grows by its square root. As queueing pushes the latency up
+            /// the limit is scaled back in proportion, by at most a half
+            /// each time, however small it is. The change is smoothed over
+            /// several samples and the limit never goes below one.
+            class gradient {
+                const double smoothing;
+                const double tolerance;
+
+              public:
+                gradient(double smoothing = 0.2, double tolerance = 1.5)
+                : smoothing(smoothing), tolerance(tolerance) {}
+
+                /// Return the new limit
+                double
+                        update(double limit,
+                               std::chrono::steady_clock::duration rtt,
+                               std::chrono::steady_clock::duration min_rtt,
+                               uint64_t) {
+                    auto const ratio = rtt.count()
+                            ? tolerance * min_rtt.count() / rtt.count()
+                            : 1.0;
+                    auto const g = std::clamp(ratio, 0.5, 1.0);
+                    auto const target =
+                            g < 1.0 ? limit * g : limit + std::sqrt(limit);
+                    return std::max(
+                            1.0, limit * (1 - smoothing) + target * smoothing);
+                }
+            };
+
+
+            /// A limiter whose limit is adjusted automatically from the
+            /// latency of the jobs, measured from when `next_job` returns
+            /// until they are done. Time spent waiting in the limiter itself
+            /// isn't included. The algorithm `A` is given each sample and
+            /// returns the new limit, which is kept between a minimum and a
+            /// maximum.
+            template<typename D, typename A = gradient>
+            class basic_adaptive_limiter {
+              public:
+                using clock_type = std::chrono::steady_clock;
+
+                /// The current state of the limiter
+                struct statistics {
+                    /// The current limit
+                    uint64_t limit = {};
+                    /// The latency of the most recent job
+                    clock_type::duration rtt = {};
+                    /// The lowest latency seen, which is taken as the
+                    /// latency without queueing. It drifts up towards
+                    /// each later sample so that one early fast sample
+                    /// can't fix the baseline for good
+                    clock_type::duration min_rtt = {};
+                    /// The number of jobs whose latency has been measured
+                    uint64_t samples = {};
+                    /// The number of times the limit has gone up and down
+                    uint64_t increases = {}, decreases = {};
+                };
+
+              private:
+                using limiter_type = basic_limiter<D>;
+
+                /// The limiter that does the work
+                limiter_type throttle;
+                /// The algorithm that decides the limit
+                A algorithm;
+                /// The bounds on the limit. The minimum is at least one, as
+                /// a zero limit would mean no limit at all
+                const uint64_t min_limit, max_limit;
+
+                /// Mutex controlling access to the estimates
+                std::mutex mutex;
+                /// The limit before rounding
+                double estimate;
+                /// The minimum latency moves one part in this many of the
+                /// way towards each sample above it, so a lasting change in
+                /// latency becomes the new baseline after a few hundred
+                /// samples
+                static constexpr int min_rtt_decay = 100;
+                /// The current state
+                statistics counters;
+
+                /// Record a job's latency and move the limit
+                void sample(clock_type::duration rtt) {
+                    std::unique_lock<std::mutex> lock{mutex};
+                    ++counters.samples;
+                    counters.rtt = rtt;
+                    if (counters.samples == 1 || rtt < counters.min_rtt) {
+                        counters.min_rtt = rtt;
+                    } else {
+                        counters.min_rtt += (rtt - counters.min_rtt)
+                                / min_rtt_decay;
+                    }
+                    estimate = std::clamp(
+                            algorithm.update(
+                                    estimate, rtt, counters.min_rtt,
+                                    throttle.outstanding()),
+                            double(min_limit), double(max_limit));
+                    auto const limit = uint64_t(estimate);
+                    if (limit > counters.limit) {
+                        throttle.increase_limit(limit - counters.limit);
+                        ++counters.increases;
+                    } else if (limit < counters.limit) {
+                        throttle.decrease_limit(counters.limit - limit);
+                        ++counters.decreases;
+                    }
+                    counters.limit = limit;
+                }
+
+                /// The initial limit brought within the bounds
+                static uint64_t bounded(
+                        uint64_t initial,
+                        uint64_t min_limit,
+                        uint64_t max_limit) {
+                    auto const lowest = std::max<uint64_t>(min_limit, 1);
+                    return std::clamp(
+                            initial, lowest, std::max(lowest, max_limit));
+                }
+
+              public:
+                /// Construct with an initial limit and the bounds it must
+                /// stay within. The initial limit is brought within the
+                /// bounds
+                basic_adaptive_limiter(
+                        boost::asio::io_service &ios,
+                        uint64_t initial,
+                        uint64_t min_limit = 1,
+                        uint64_t max_limit = 1000,
+                        A algorithm = A{})
+                : throttle(ios, bounded(initial, min_limit, max_limit)),
+                  algorithm(std::move(algorithm)),
+                  min_limit(std::max<uint64_t>(min_limit, 1)),
+                  max_limit(std::max(max_limit, this->min_limit)),
+                  estimate(throttle.limit()) {
+                    counters.limit = throttle.limit();
+                }
+
+                /// Return the IO service
+                boost::asio::io_service &get_io_service() {
+                    return throttle.get_io_service();
+                }
+
+                /// The maximum number of outstanding jobs
+                uint64_t limit() const { return throttle.limit(); }
+                /// The current number of outstanding jobs
+                uint64_t outstanding() const { return throttle.outstanding(); }
+                /// The current limit and latency estimates
+                statistics stats() {
+                    std::unique_lock<std::mutex> lock{mutex};
+                    return counters;
+                }
+
+                /// A move only token for an outstanding job. The job's
+                /// latency is measured when the token is destroyed or `done`
+                /// is called.
+                class token {
+                    friend class basic_adaptive_limiter;
+                    /// The limiter that owns this job
+                    basic_adaptive_limiter *limit = nullptr;
+                    /// The token from the underlying limiter
+                    typename limiter_type::token job;
+                    /// When the job started
+                    clock_type::time_point started;
+
+                    token(basic_adaptive_limiter &l,
+                          typename limiter_type::token t)
+                    : limit(&l),
+                      job(std::move(t)),
+                      started(clock_type::now()) {}
+
+                  public:
+                    token() = default;
+                    token(token &&t) noexcept
+                    : limit(std::exchange(t.limit, nullptr)),
+                      job(std::move(t.job)),
+                      started(t.started) {}
+                    token &operator=(token &&t) noexcept {
+                        done();
+                        limit = std::exchange(t.limit, nullptr);
+                        job = std::move(t.job);
+                        started = t.started;
+                        return *this;
+                    }
+                    ~token() { done(); }
+
+                    /// Returns true if the job hasn't been completed
+                    explicit operator bool() const { return limit; }
+
+                    /// Signal that the job is completed, if not already
+                    /// done so
+                    void done() {
+                        if (limit) {
+                            // Sample first so that the algorithm sees the
+                            // outstanding count including this job
+                            std::exchange(limit, nullptr)
+                                    ->sample(clock_type::now() - started);
+                            job.done();
+                        }
+                    }
+                };
+
+                /// Add another outstanding job and return a token for it
+                token next_job(boost::asio::yield_context yield) {
+                    return token{*this, throttle.next_token(yield)};
+                }
+
+                /// Yield until all of the outstanding jobs are done
+                void wait_for_all_outstanding(
+                        boost::asio::yield_context yield) {
+                    throttle.wait_for_all_outstanding(yield);
+                }
+
+                /// Close it
+                void close() { throttle.close(); }
+            };
+
+
+            /// An adaptive limiter using the default descriptor
+            template<typename A = gradient>
+            using adaptive_limiter =
+                    basic_adaptive_limiter<signalling_descriptor, A>;
+
+
+        }
+
+
+    }
+
+
+}
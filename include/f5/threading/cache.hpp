@@ -0,0 +1,328 @@
+/**
+    Copyright 2026 Red Anchor Trading Co. Ltd.
+
+    Distributed under the Boost Software License, Version 1.0.
+    See <http://www.boost.org/LICENSE_1_0.txt>
+ */
+
+
+#pragma once
+
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include <f5/threading/policy.hpp>
+
+
+namespace f5 {
+
+
+    inline namespace threading {
+
+
+        /// Thread safe cache with a bounded capacity and an optional time
+        /// to live for each entry. When the cache is full the least
+        /// recently used entry is evicted. Expired entries are treated as
+        /// misses and are removed when they are next seen or when `expire`
+        /// is called.
+        ///
+        /// The eviction callback is always called without the cache's lock
+        /// being held.
+        ///
+        /// Any insert can evict an entry, so the cache only hands out
+        /// values that own or copy what they refer to. Policies that
+        /// return references or pointers into the entry, such as
+        /// `pointer_dereference_policy` for `std::unique_ptr`, are
+        /// rejected. Use `std::shared_ptr` for values that are expensive to
+        /// copy.
+        template<
+                typename K,
+                typename V,
+                typename P = typename container_default_policy<V>::type,
+                typename C = std::chrono::steady_clock,
+                typename H = std::hash<K>>
+        class tscache {
+          public:
+            /// The clock used to time the entries
+            using clock_type = C;
+            /// The type used for the time to live
+            using duration = typename C::duration;
+            /// The type of the function called when an entry is evicted or
+            /// expires
+            using eviction_callback = std::function<void(const K &, V &)>;
+
+            /// Counters describing how effective the cache is being
+            struct statistics {
+                /// Look ups and writes that found, or didn't find, a live
+                /// entry for their key
+                std::uint64_t hits = {}, misses = {};
+                /// Entries removed to make space
+                std::uint64_t evictions = {};
+                /// Entries removed because their time to live passed
+                std::uint64_t expirations = {};
+            };
+
+          private:
+            /// The items stored in the recency list
+            struct entry {
+                K key;
+                V value;
+                typename C::time_point expires;
+            };
+            using list_type = std::list<entry>;
+
+            /// Mutex used to control access to the cache
+            mutable std::mutex mutex;
+            /// Entries in order of use, the most recent being first
+            list_type lru;
+            /// Index from the key to its entry
+            std::unordered_map<K, typename list_type::iterator, H> index;
+            /// The maximum number of entries. Zero means no limit
+            const std::size_t capacity;
+            /// The time to live for each entry. Zero means forever
+            const duration ttl;
+            /// Called for each entry that is removed other than through
+            /// `remove` or `clear`
+            const eviction_callback evicted;
+            /// The counters
+            statistics counters;
+
+            /// Traits for controlling aspects of the implementation
+            using traits = P;
+            static_assert(
+                    not std::is_reference_v<
+                            typename traits::value_return_type>
+                            and (not std::is_pointer_v<
+                                         typename traits::found_type>
+                                 or std::is_same_v<
+                                         typename traits::found_type, V>),
+                    "A tscache entry can be evicted by any insert, so "
+                    "its policy must not return references or pointers "
+                    "into the entry");
+
+            /// The expiry time for an entry made now
+            typename C::time_point expiry() const {
+                if (ttl == duration::zero()) {
+                    return C::time_point::max();
+                } else {
+                    return C::now() + ttl;
+                }
+            }
+            /// Return true if the entry has expired
+            bool expired(const entry &e) const {
+                return ttl != duration::zero() && e.expires <= C::now();
+            }
+            /// Move the entry out of the cache into the list of those to
+            /// be passed to the eviction callback. The lock must be held
+            void evict(typename list_type::iterator pos, list_type &out) {
+                index.erase(pos->key);
+                out.splice(out.end(), lru, pos);
+            }
+            /// Evict from the least recently used end until there is room
+            /// for one more entry. The lock must be held
+            void make_room(list_type &out) {
+                while (capacity && lru.size() >= capacity) {
+                    evict(std::prev(lru.end()), out);
+                    ++counters.evictions;
+                }
+            }
+            /// Call the eviction callback on the entries. The lock must not
+            /// be held
+            void notify(list_type &out) {
+                if (evicted) {
+                    for (auto &e : out) evicted(e.key, e.value);
+                }
+            }
+            /// Insert a new entry at the front of the recency list. The
+            /// lock must be held
+            template<typename A>
+            V &insert(const K &k, A &&a, list_type &out) {
+                make_room(out);
+                lru.push_front(entry{k, std::forward<A>(a), expiry()});
+                index.emplace(k, lru.begin());
+                return lru.front().value;
+            }
+            /// Return the live entry for the key, marking it as the most
+            /// recently used. An expired entry is evicted. The lock must be
+            /// held
+            template<typename L>
+            typename list_type::iterator lookup(const L &k, list_type &out) {
+                auto const pos = index.find(k);
+                if (pos == index.end()) {
+                    return lru.end();
+                } else if (expired(*pos->second)) {
+                    evict(pos->second, out);
+                    ++counters.expirations;
+                    return lru.end();
+                } else {
+                    lru.splice(lru.begin(), lru, pos->second);
+                    return lru.begin();
+                }
+            }
+
+          public:
+            /// Construct a cache holding at most `capacity` entries, each
+            /// of which will live for `ttl`. A zero capacity means no limit
+            /// and a zero `ttl` means that entries don't expire.
+            explicit tscache(
+                    std::size_t capacity,
+                    duration ttl = duration::zero(),
+                    eviction_callback cb = {})
+            : capacity(capacity), ttl(ttl), evicted(std::move(cb)) {}
+
+            /// Make non-copyable and non assignable
+            tscache(const tscache &) = delete;
+            tscache &operator=(const tscache &) = delete;
+
+            /// Return an estimate of the size of the cache.
+            std::size_t size() {
+                std::unique_lock<std::mutex> lock(mutex);
+                return lru.size();
+            }
+            /// Return the hit, miss and eviction counters
+            statistics stats() const {
+                std::unique_lock<std::mutex> lock(mutex);
+                return counters;
+            }
+
+            /// Return a pointer to the value if found. If not found, or it
+            /// has expired, then return `nullptr`
+            template<typename L>
+            typename traits::found_type find(const L &k) {
+                list_type out;
+                std::unique_lock<std::mutex> lock(mutex);
+                auto const pos = lookup(k, out);
+                if (pos == lru.end()) {
+                    ++counters.misses;
+                    lock.unlock();
+                    notify(out);
+                    return nullptr;
+                } else {
+                    ++counters.hits;
+                    return traits::found_from_V(pos->value);
+                }
+            }
+            /// Return either the item in the cache, or the passed in default.
+            template<typename L>
+            typename traits::found_type
+                    find(const L &k, typename traits::found_type d) {
+                if (auto p = find(k); p)
+                    return p;
+                else
+                    return d;
+            }
+
+            /// Ensures the item at the requested key is the value given.
+            /// This restarts the entry's time to live.
+            template<typename A>
+            typename traits::value_return_type
+                    insert_or_assign(const K &k, A a) {
+                list_type out;
+                std::unique_lock<std::mutex> lock(mutex);
+                auto const pos = lookup(k, out);
+                if (pos != lru.end()) {
+                    ++counters.hits;
+                    pos->value = std::move(a);
+                    pos->expires = expiry();
+                    return traits::value_from_V(pos->value);
+                }
+                ++counters.misses;
+                typename traits::value_return_type result =
+                        traits::value_from_V(insert(k, std::move(a), out));
+                lock.unlock();
+                notify(out);
+                return result;
+            }
+            /// Adds the item if the key is not found. If the key is found and
+            /// the predicate returns true then replaces the value with the
+            /// one returned by the lambda
+            template<typename Pr, typename F>
+            typename traits::value_return_type
+                    insert_or_assign_if(const K &k, Pr predicate, F lambda) {
+                list_type out;
+                std::unique_lock<std::mutex> lock(mutex);
+                auto const pos = lookup(k, out);
+                if (pos != lru.end()) {
+                    ++counters.hits;
+                    if (predicate(pos->value)) {
+                        pos->value = lambda();
+                        pos->expires = expiry();
+                    }
+                    return traits::value_from_V(pos->value);
+                }
+                ++counters.misses;
+                typename traits::value_return_type result =
+                        traits::value_from_V(insert(k, lambda(), out));
+                lock.unlock();
+                notify(out);
+                return result;
+            }
+            /// Adds a value at the key if there isn't one there already.
+            /// Returns a reference to the item
+            template<typename F>
+            typename traits::value_return_type
+                    add_if_not_found(const K &k, F lambda) {
+                list_type out;
+                std::unique_lock<std::mutex> lock(mutex);
+                auto const pos = lookup(k, out);
+                if (pos != lru.end()) {
+                    ++counters.hits;
+                    return traits::value_from_V(pos->value);
+                }
+                ++counters.misses;
+                typename traits::value_return_type result =
+                        traits::value_from_V(insert(k, lambda(), out));
+                lock.unlock();
+                notify(out);
+                return result;
+            }
+
+            /// Remove the requested key (if found). Returns true if the
+            /// key and its value were removed
+            bool remove(const K &k) {
+                list_type out;
+                std::unique_lock<std::mutex> lock(mutex);
+                auto const pos = index.find(k);
+                if (pos == index.end()) {
+                    return false;
+                } else {
+                    evict(pos->second, out);
+                    return true;
+                }
+            }
+            /// Remove all of the entries whose time to live has passed.
+            /// Returns the number removed
+            std::size_t expire() {
+                list_type out;
+                std::unique_lock<std::mutex> lock(mutex);
+                for (auto pos = lru.begin(); pos != lru.end();) {
+                    auto const here = pos++;
+                    if (expired(*here)) evict(here, out);
+                }
+                counters.expirations += out.size();
+                lock.unlock();
+                notify(out);
+                return out.size();
+            }
+            /// Remove all entries from the cache
+            std::size_t clear() {
+                list_type out;
+                std::unique_lock<std::mutex> lock(mutex);
+                index.clear();
+                out.swap(lru);
+                return out.size();
+            }
+        };
+
+
+    }
+
+
+}
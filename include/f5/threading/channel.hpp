@@ -1,5 +1,5 @@
 /**
-    Copyright 2017-2019 Red Anchor Trading Co. Ltd.
+    Copyright 2017-2026 Red Anchor Trading Co. Ltd.
 
     Distributed under the Boost Software License, Version 1.0.
     See <http://www.boost.org/LICENSE_1_0.txt>
@@ -9,10 +9,16 @@
 #pragma once
 
 
+#include <f5/threading/priority.hpp>
 #include <f5/threading/queue.hpp>
 
 #include <boost/circular_buffer.hpp>
 
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
 
 namespace f5 {
 
@@ -23,19 +29,29 @@ namespace f5 {
         /// Combine a circular buffer and an eventfd limiter for mulitple
         /// producers and consumers in a capacity limited manner. For a
         /// similar construct which accepts unlimited items see queue.
-        template<typename V>
+        ///
+        /// The limiter type `L` decides which producer gets space when it
+        /// is freed. Use `priority_limiter` to give producers priorities.
+        template<typename V, typename L = fd::limiter>
         class channel {
-            using queue_job = std::pair<std::unique_ptr<fd::limiter::job>, V>;
+            using queue_job = std::pair<typename L::token, V>;
             using queue_type =
                     queue<queue_job, boost::circular_buffer<queue_job>>;
             queue_type buffer;
-            fd::limiter throttle;
+            L throttle;
 
           public:
-            /// Construct a new channel with the specified capacity
-            channel(boost::asio::io_service &ios, uint64_t limit)
+            /// The type of item that is put in the channel
+            using value_type = V;
+
+            /// Construct a new channel with the specified capacity. Any
+            /// further arguments are passed on to the limiter
+            template<typename... Args>
+            channel(boost::asio::io_service &ios,
+                    uint64_t limit,
+                    Args &&... args)
             : buffer(ios, typename queue_type::store_type(limit)),
-              throttle(ios, limit) {}
+              throttle(ios, limit, std::forward<Args>(args)...) {}
 
             /// Return the IO service
             boost::asio::io_service &get_io_service() {
@@ -48,9 +64,42 @@ namespace f5 {
             /// there is space for the item. Returns the remaining capacity
             template<typename Y>
             void produce(V v, Y yield) {
-                auto job = throttle.next_job(yield);
+                auto job = throttle.next_token(yield);
                 buffer.produce(std::make_pair(std::move(job), std::move(v)));
             }
+            /// Add a new item to the buffer with the given priority, which
+            /// is passed to the limiter. The coroutine yields until there is
+            /// space for the item.
+            template<typename Y>
+            void produce(V v, std::size_t priority, Y yield) {
+                auto job = throttle.next_token(priority, yield);
+                buffer.produce(std::make_pair(std::move(job), std::move(v)));
+            }
+
+            /// Add all of the items in the range to the buffer, in order.
+            /// Items that there is space for are added together. The
+            /// coroutine yields when the buffer is full, after first adding
+            /// what it has so far. Items are moved from an rvalue range.
+            template<typename R, typename Y>
+            void produce_many(R &&range, Y yield) {
+                std::vector<queue_job> batch;
+                for (auto &v : range) {
+                    auto job = throttle.try_next_token();
+                    if (not job) {
+                        // Other producers may be holding space too, so
+                        // what we have must be visible before we wait
+                        buffer.produce_many(std::move(batch));
+                        batch.clear();
+                        job = throttle.next_token(yield);
+                    }
+                    if constexpr (std::is_rvalue_reference_v<R &&>) {
+                        batch.emplace_back(std::move(job), std::move(v));
+                    } else {
+                        batch.emplace_back(std::move(job), v);
+                    }
+                }
+                buffer.produce_many(std::move(batch));
+            }
 
             /// Yield until a value is available to consume. The space in
             /// the buffer is freed up straight away.
@@ -58,6 +107,41 @@ namespace f5 {
             V consume(Y yield) {
                 return buffer.consume(yield).second;
             }
+            /// Return a value if one is available. Its space in the buffer
+            /// is freed up straight away
+            std::optional<V> consume() {
+                if (auto job = buffer.consume()) {
+                    return std::move(job->second);
+                } else {
+                    return {};
+                }
+            }
+            /// Yield until at least one value is available and then return
+            /// up to `max` values. The space they took up in the buffer is
+            /// all freed in one step.
+            template<typename Y>
+            std::vector<V> consume_many(Y yield, std::size_t max) {
+                auto jobs = buffer.consume_many(yield, max);
+                std::vector<typename L::token> tokens;
+                std::vector<V> values;
+                tokens.reserve(jobs.size());
+                values.reserve(jobs.size());
+                for (auto &j : jobs) {
+                    tokens.push_back(std::move(j.first));
+                    values.push_back(std::move(j.second));
+                }
+                throttle.complete_all(tokens.begin(), tokens.end());
+                return values;
+            }
+
+            /// True if there is nothing waiting to be consumed
+            bool empty() const { return buffer.empty(); }
+            /// True once the channel has been closed
+            bool closed() const { return buffer.closed(); }
+            /// Resume the coroutine the next time anything is produced
+            void watch(resumer r) { buffer.watch(std::move(r)); }
+            /// Stop watching for items, if the resumer hasn't been used
+            void unwatch(const resumer &r) { buffer.unwatch(r); }
 
             /// Yield until all of the work that has been produced has been
             /// consumed.
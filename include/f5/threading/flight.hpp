@@ -0,0 +1,169 @@
+/**
+    Copyright 2026 Red Anchor Trading Co. Ltd.
+
+    Distributed under the Boost Software License, Version 1.0.
+    See <http://www.boost.org/LICENSE_1_0.txt>
+ */
+
+
+#pragma once
+
+
+#include <f5/threading/map.hpp>
+#include <f5/threading/suspend.hpp>
+
+#include <boost/coroutine/exceptions.hpp>
+
+#include <condition_variable>
+#include <exception>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+
+namespace f5 {
+
+
+    inline namespace threading {
+
+
+        /// A `tsmap` whose missing values are computed without holding
+        /// the map's lock. Concurrent requests for the same missing key
+        /// share a single computation (a "single flight"), and if it fails
+        /// they all see the exception. Failures are not stored so a later
+        /// request will try again.
+        template<
+                typename K,
+                typename V,
+                typename P = typename container_default_policy<V>::type,
+                typename Mutex = std::mutex>
+        class tsflight {
+          public:
+            /// The map that the computed values are stored in
+            using map_type = tsmap<K, V, P, Mutex>;
+
+          private:
+            /// Traits for controlling aspects of the implementation
+            using traits = P;
+            using found_type = typename traits::found_type;
+
+            /// A computation that is under way
+            struct flight {
+                std::mutex mutex;
+                bool landed = false;
+                std::optional<found_type> value;
+                std::exception_ptr error;
+                /// Threads blocked waiting for the result
+                std::condition_variable blocked;
+                /// Coroutines suspended waiting for the result
+                std::vector<boost_asio::resumer> suspended;
+
+                /// Store the outcome and wake everything waiting for it
+                void
+                        land(std::optional<found_type> v,
+                             std::exception_ptr e) {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    value = std::move(v);
+                    error = std::move(e);
+                    landed = true;
+                    auto waiting = std::move(suspended);
+                    lock.unlock();
+                    blocked.notify_all();
+                    for (auto &r : waiting) r();
+                }
+                /// Return the outcome. Only valid once landed
+                found_type outcome() const {
+                    if (error) std::rethrow_exception(error);
+                    return *value;
+                }
+            };
+
+            /// The stored values
+            map_type values;
+            /// The computations under way
+            tsmap<K, std::shared_ptr<flight>> flying;
+
+            /// Join the computation for the key. If there isn't one then
+            /// it is created and `leader` is set to true
+            std::shared_ptr<flight> join(const K &k, bool &leader) {
+                return flying.add_if_not_found(k, [&leader]() {
+                    leader = true;
+                    return std::make_shared<flight>();
+                });
+            }
+            /// Run the factory, store its result and land the flight
+            template<typename F>
+            found_type lead(const K &k, flight &f, F &factory) {
+                try {
+                    // The value may have been stored after we last looked
+                    // but before we joined
+                    auto found = values.find(k);
+                    if (not found) {
+                        V v = factory();
+                        found = traits::found_from_V(v);
+                        values.insert_or_assign(k, std::move(v));
+                    }
+                    f.land(found, {});
+                    flying.remove(k);
+                    return found;
+                } catch (boost::coroutines::detail::forced_unwind &) {
+                    f.land({}, std::make_exception_ptr(
+                                       std::runtime_error(
+                                               "Computation was abandoned")));
+                    flying.remove(k);
+                    throw;
+                } catch (...) {
+                    f.land({}, std::current_exception());
+                    flying.remove(k);
+                    throw;
+                }
+            }
+
+          public:
+            /// Access the map for all other operations
+            map_type &map() { return values; }
+            const map_type &map() const { return values; }
+
+            /// Return the value at the key. If there isn't one then the
+            /// factory is run, without the map's lock being held, and its
+            /// result is stored. If another thread is already computing the
+            /// value then this blocks until it is done.
+            template<typename F>
+            found_type get_or_compute(const K &k, F factory) {
+                if (auto found = values.find(k); found) return found;
+                bool leader = false;
+                auto f = join(k, leader);
+                if (leader) return lead(k, *f, factory);
+                std::unique_lock<std::mutex> lock(f->mutex);
+                f->blocked.wait(lock, [&f]() { return f->landed; });
+                return f->outcome();
+            }
+            /// Return the value at the key. If there isn't one then the
+            /// factory is run, without the map's lock being held, and its
+            /// result is stored. If another coroutine or thread is already
+            /// computing the value then this coroutine is suspended until it
+            /// is done.
+            template<typename F, typename Y>
+            found_type get_or_compute(const K &k, F factory, Y yield) {
+                if (auto found = values.find(k); found) return found;
+                bool leader = false;
+                auto f = join(k, leader);
+                if (leader) return lead(k, *f, factory);
+                boost_asio::suspend(yield, [&f](boost_asio::resumer r) {
+                    std::unique_lock<std::mutex> lock(f->mutex);
+                    if (f->landed) {
+                        lock.unlock();
+                        r();
+                    } else {
+                        f->suspended.push_back(std::move(r));
+                    }
+                });
+                return f->outcome();
+            }
+        };
+
+
+    }
+
+
+}
@@ -0,0 +1,300 @@
+/**
+    Copyright 2026 Red Anchor Trading Co. Ltd.
+
+    Distributed under the Boost Software License, Version 1.0.
+    See <http://www.boost.org/LICENSE_1_0.txt>
+ */
+
+
+#pragma once
+
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include <f5/threading/policy.hpp>
+
+
+namespace f5 {
+
+
+    inline namespace threading {
+
+
+        /// Thread safe associative array (map) implemented as a flat open
+        /// addressing hash table using linear probing. It has the same
+        /// interface as `tsmap` and can be used in its place when the keys
+        /// don't need to be ordered. Iteration is in no particular order.
+        template<
+                typename K,
+                typename V,
+                typename P = typename container_default_policy<V>::type,
+                typename Mutex = std::mutex,
+                typename H = std::hash<K>>
+        class tshashmap {
+            /// Mutex used to control access to the table
+            mutable Mutex mutex;
+            /// The slots that make up the table. The number of slots is
+            /// always zero or a power of two
+            std::vector<std::optional<std::pair<K, V>>> slots;
+            /// The number of occupied slots
+            std::size_t count = {};
+            /// The number of bits of the hash used to pick the home slot
+            std::size_t bits = {};
+
+            /// Traits for controlling aspects of the implementation
+            using traits = P;
+            /// The lock used by members that only read the data
+            using read_lock = typename container_read_lock<Mutex>::type;
+
+            /// The slot that a key would occupy if there were no collisions.
+            /// The hash is spread over the table using Fibonacci hashing so
+            /// that poor hashes (like those for integers) don't cluster.
+            template<typename L>
+            std::size_t home(const L &k) const {
+                const std::uint64_t h = H{}(k);
+                return (h * 0x9e3779b97f4a7c15u) >> (64u - bits);
+            }
+            /// The slot after the one given
+            std::size_t next(std::size_t i) const {
+                return (i + 1) & (slots.size() - 1);
+            }
+
+            /// Return the slot the key is in, or the empty slot where it
+            /// should be inserted. There must be at least one slot.
+            template<typename L>
+            std::size_t probe(const L &k) const {
+                auto i = home(k);
+                while (slots[i] && not(k == slots[i]->first)) i = next(i);
+                return i;
+            }
+            /// Return the slot the key is in, if it is in the table
+            template<typename L>
+            std::optional<std::size_t> locate(const L &k) const {
+                if (slots.empty()) return {};
+                auto const i = probe(k);
+                if (slots[i])
+                    return i;
+                else
+                    return {};
+            }
+
+            /// Resize the table to the requested number of bits and
+            /// re-insert everything already there
+            void rehash(std::size_t b) {
+                std::vector<std::optional<std::pair<K, V>>> old(
+                        std::size_t{1} << b);
+                old.swap(slots);
+                bits = b;
+                for (auto &s : old) {
+                    if (s) slots[probe(s->first)] = std::move(s);
+                }
+            }
+            /// Return the slot that the key is in or, after making sure
+            /// that there is room for one more item, the slot it should go
+            /// in. The table only grows when the key is missing
+            std::size_t reserve_for(const K &k) {
+                if (slots.empty()) {
+                    rehash(4);
+                    return probe(k);
+                }
+                auto const i = probe(k);
+                if (slots[i] || (count + 1) * 4 <= slots.size() * 3) {
+                    return i;
+                }
+                rehash(bits + 1);
+                return probe(k);
+            }
+            /// Construct the item in the (empty) slot and return its value
+            template<typename... Args>
+            V &construct(std::size_t i, const K &k, Args &&... args) {
+                slots[i].emplace(
+                        std::piecewise_construct, std::forward_as_tuple(k),
+                        std::forward_as_tuple(std::forward<Args>(args)...));
+                ++count;
+                return slots[i]->second;
+            }
+            /// Empty the slot and then shift any following items back so
+            /// that no look up will stop early at the hole
+            void erase(std::size_t i) {
+                slots[i].reset();
+                --count;
+                for (auto j = next(i); slots[j]; j = next(j)) {
+                    auto const h = home(slots[j]->first);
+                    bool const stays =
+                            (i < j) ? (i < h && h <= j) : (i < h || h <= j);
+                    if (not stays) {
+                        slots[i] = std::move(slots[j]);
+                        slots[j].reset();
+                        i = j;
+                    }
+                }
+            }
+
+          public:
+            /// Return an estimate of the size of the map.
+            std::size_t size() {
+                read_lock lock(mutex);
+                return count;
+            }
+
+            /// Return a pointer to the value if found. If not found then
+            /// return `nullptr`
+            template<typename L>
+            typename traits::found_type find(const L &k) const {
+                read_lock lock(mutex);
+                if (auto i = locate(k); i) {
+                    return traits::found_from_V(slots[*i]->second);
+                } else {
+                    return nullptr;
+                }
+            }
+            /// Return either the item in the map, or the passed in default.
+            template<typename L>
+            typename traits::found_type
+                    find(const L &k, typename traits::found_type d) const {
+                if (auto p = find(k); p)
+                    return p;
+                else
+                    return d;
+            }
+            /// Run the lambda on the found item. Return true if the lambda
+            /// was run.
+            template<typename L, typename F>
+            bool alter(L const &k, F lambda) {
+                std::unique_lock<Mutex> lock(mutex);
+                if (auto i = locate(k); i) {
+                    lambda(traits::reference_from_V(slots[*i]->second));
+                    return true;
+                } else {
+                    return false;
+                }
+            }
+
+            /// Ensures the item at the requested key is the value given
+            template<typename A>
+            typename traits::value_return_type
+                    insert_or_assign(const K &k, A a) {
+                std::unique_lock<Mutex> lock(mutex);
+                auto const i = reserve_for(k);
+                if (slots[i]) {
+                    return traits::value_from_V(
+                            slots[i]->second = std::move(a));
+                } else {
+                    return traits::value_from_V(construct(i, k, std::move(a)));
+                }
+            }
+            /// Adds the item if the key is not found. If the key is found and
+            /// the predicate returns true then replaces the value with the
+            /// one returned by the lambda
+            template<typename C, typename F>
+            typename traits::value_return_type
+                    insert_or_assign_if(const K &k, C predicate, F lambda) {
+                std::unique_lock<Mutex> lock(mutex);
+                auto const i = reserve_for(k);
+                if (slots[i]) {
+                    if (predicate(slots[i]->second)) {
+                        return traits::value_from_V(
+                                slots[i]->second = lambda());
+                    } else {
+                        return traits::value_from_V(slots[i]->second);
+                    }
+                }
+                return traits::value_from_V(construct(i, k, lambda()));
+            }
+            /// Adds a value at the key if there isn't one there already.
+            /// Returns a reference to the item
+            template<typename... Args>
+            typename traits::value_return_type
+                    emplace_if_not_found(const K &k, Args &&... args) {
+                std::unique_lock<Mutex> lock(mutex);
+                auto const i = reserve_for(k);
+                if (slots[i]) {
+                    return traits::value_from_V(slots[i]->second);
+                }
+                return traits::value_from_V(
+                        construct(i, k, std::forward<Args>(args)...));
+            }
+            /// Adds a value at the key if there isn't one there already.
+            /// Returns a reference to the newly constructed item. If
+            /// the item is already in the map then the second lambda is
+            /// executed.
+            template<typename F, typename M>
+            typename traits::value_return_type
+                    add_if_not_found(const K &k, F lambda, M miss) {
+                std::unique_lock<Mutex> lock(mutex);
+                auto const i = reserve_for(k);
+                if (slots[i]) {
+                    miss(traits::reference_from_V(slots[i]->second));
+                    return traits::value_from_V(slots[i]->second);
+                }
+                return traits::value_from_V(construct(i, k, lambda()));
+            }
+            /// Adds a value at the key if there isn't one there already.
+            template<typename F>
+            typename traits::value_return_type
+                    add_if_not_found(const K &k, F lambda) {
+                return add_if_not_found(k, lambda, [](const auto &) {});
+            }
+
+            /// Iterate over the content of the map. The order is not
+            /// specified
+            template<typename F>
+            F for_each(F fn) const {
+                read_lock lock(mutex);
+                for (auto const &s : slots) {
+                    if (s) fn(s->first, s->second);
+                }
+                return fn;
+            }
+
+            /// Remove the requested key (if found). Returns true if the
+            /// key and its value were removed
+            bool remove(const K &k) {
+                std::unique_lock<Mutex> lock(mutex);
+                if (auto i = locate(k); i) {
+                    erase(*i);
+                    return true;
+                } else {
+                    return false;
+                }
+            }
+
+            /// Removes values where the predicate is true. Returns how
+            /// many are left.
+            template<typename Pr>
+            std::size_t remove_if(Pr predicate) {
+                std::unique_lock<Mutex> lock(mutex);
+                bool removed = false;
+                for (auto &s : slots) {
+                    if (s && predicate(s->first, s->second)) {
+                        s.reset();
+                        --count;
+                        removed = true;
+                    }
+                }
+                // Re-inserting everything is simpler than shifting after
+                // each removal
+                if (removed) rehash(bits);
+                return count;
+            }
+
+            /// Remove all entries for the map
+            std::size_t clear() {
+                std::unique_lock<Mutex> lock(mutex);
+                const auto r = count;
+                slots.clear();
+                count = 0;
+                bits = 0;
+                return r;
+            }
+        };
+
+
+    }
+
+
+}
@@ -1,5 +1,5 @@
 /**
-    Copyright 2015-2019 Red Anchor Trading Co. Ltd.
+    Copyright 2015-2026 Red Anchor Trading Co. Ltd.
 
     Distributed under the Boost Software License, Version 1.0.
     See <http://www.boost.org/LICENSE_1_0.txt>
@@ -14,10 +14,17 @@
 #include <boost/asio/spawn.hpp>
 #include <boost/version.hpp>
 
+#include <algorithm>
 #include <atomic>
+#include <limits>
+#include <memory>
 #include <system_error>
+#include <utility>
 
 #include <unistd.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
 
 
 namespace f5 {
@@ -29,9 +36,21 @@ namespace f5 {
         namespace fd {
 
 
+            /// How a signalling descriptor reports the counts written to it
+            enum class counting {
+                /// Each wait returns one and consumes one from the count
+                semaphore,
+                /// Each wait returns, and consumes, the whole count
+                counter
+            };
+
+
             /// An internal pipe. Data may be written and read from it. There is
             /// no explicit data framing--it is assumed that the user will
             /// perform any that is needed.
+            ///
+            /// When used for signalling each byte carries a count of up to
+            /// 255, and each wait reads one byte, whatever the counting.
             class pipe {
                 boost::asio::posix::stream_descriptor read, write;
 
@@ -41,7 +60,9 @@ namespace f5 {
                         boost::asio::posix::stream_descriptor::executor_type;
 #endif
 
-                pipe(boost::asio::io_service &ios) : read(ios), write(ios) {
+                pipe(boost::asio::io_service &ios,
+                     counting = counting::counter)
+                : read(ios), write(ios) {
                     std::array<int, 2> p{{0, 0}};
                     if (::pipe(p.data()) < 0)
                         throw std::system_error(errno, std::system_category());
@@ -61,6 +82,35 @@ namespace f5 {
                     return write.async_write_some(std::forward<U>(u)...);
                 }
 
+                /// Send the count to the reading side. The error function is
+                /// called if a write fails
+                template<typename E>
+                void signal(uint64_t count, E efn) {
+                    while (count) {
+                        // The byte has to outlive the write, which may not
+                        // complete straight away if the pipe is full
+                        auto c = std::make_shared<unsigned char>(
+                                std::min(count, uint64_t{255}));
+                        count -= *c;
+                        boost::asio::async_write(
+                                *this, boost::asio::buffer(c.get(), 1),
+                                [c, efn](auto error, auto bytes) {
+                                    if (error) efn(error, bytes);
+                                });
+                    }
+                }
+                /// Return a count sent by `signal`. Yields until there is
+                /// one available.
+                uint64_t wait(boost::asio::yield_context yield) {
+                    unsigned char c{};
+                    while (not c) {
+                        boost::asio::async_read(
+                                read, boost::asio::buffer(&c, 1),
+                                boost::asio::transfer_exactly(1), yield);
+                    }
+                    return c;
+                }
+
                 /// Close both ends of the pipe
                 void close() {
                     read.close();
@@ -69,53 +119,231 @@ namespace f5 {
             };
 
 
+#ifdef __linux__
+            /// A Linux eventfd used for signalling counts. However many
+            /// counts are outstanding a signal is a single `write` and a
+            /// wait a single `read`.
+            class eventfd {
+                boost::asio::posix::stream_descriptor descriptor;
+
+              public:
+                eventfd(boost::asio::io_service &ios,
+                        counting c = counting::counter)
+                : descriptor(ios) {
+                    int const fd = ::eventfd(
+                            0,
+                            EFD_NONBLOCK | EFD_CLOEXEC
+                                    | (c == counting::semaphore
+                                               ? EFD_SEMAPHORE
+                                               : 0));
+                    if (fd < 0)
+                        throw std::system_error(errno, std::system_category());
+                    descriptor.assign(fd);
+                }
+
+                /// Add the count to the eventfd. This is a system call made
+                /// directly from the calling thread. The error function is
+                /// called if the write fails
+                template<typename E>
+                void signal(uint64_t count, E efn) {
+                    if (not count) return;
+                    auto const written = ::write(
+                            descriptor.native_handle(), &count,
+                            sizeof(count));
+                    if (written != sizeof(count)) {
+                        efn(boost::system::error_code(
+                                    errno, boost::system::system_category()),
+                            std::size_t{});
+                    }
+                }
+                /// Return the count, or one in semaphore mode. Yields until
+                /// the count is not zero.
+                uint64_t wait(boost::asio::yield_context yield) {
+                    uint64_t count{};
+                    boost::asio::async_read(
+                            descriptor,
+                            boost::asio::buffer(&count, sizeof(count)),
+                            boost::asio::transfer_exactly(sizeof(count)),
+                            yield);
+                    return count;
+                }
+
+                /// Close the eventfd
+                void close() { descriptor.close(); }
+            };
+#endif
+
+
+            /// Counts the coroutines parked waiting on a signalling
+            /// descriptor so that the descriptor is only touched when one of
+            /// them actually needs waking. A waker claims parked coroutines
+            /// before signalling them, so every signal written is matched
+            /// by exactly one wait and nothing is left behind in the
+            /// descriptor.
+            template<typename D>
+            class parking {
+                /// The descriptor used to wake parked coroutines
+                D &pp;
+                /// The number of parked coroutines that haven't been claimed
+                /// by a waker
+                std::atomic<uint64_t> m_parked{};
+
+                /// Remove up to `count` from the parked count. Returns how
+                /// many were removed
+                uint64_t claim(uint64_t count) {
+                    auto parked = m_parked.load();
+                    while (parked) {
+                        auto const take = std::min(count, parked);
+                        if (m_parked.compare_exchange_weak(
+                                    parked, parked - take)) {
+                            return take;
+                        }
+                    }
+                    return 0;
+                }
+
+              public:
+                parking(D &d) : pp(d) {}
+
+                /// The number of parked coroutines
+                uint64_t parked() const { return m_parked.load(); }
+
+                /// Park the coroutine until it is woken. The condition is
+                /// checked after registering as parked so that a wake up
+                /// can't be missed. If it is true then the coroutine
+                /// returns straight away unless it has already been claimed.
+                template<typename C>
+                void park(C ready, boost::asio::yield_context yield) {
+                    ++m_parked;
+                    if (ready() && claim(1)) return;
+                    try {
+                        auto const woken = pp.wait(yield);
+                        // A single wait may have taken the signal for more
+                        // than one coroutine, so pass the rest on
+                        if (woken > 1) pp.signal(woken - 1, [](auto, auto) {});
+                    } catch (...) {
+                        claim(1);
+                        throw;
+                    }
+                }
+                /// Wake up to `count` parked coroutines. The error function
+                /// is called if signalling fails
+                template<typename E>
+                void wake(uint64_t count, E efn) {
+                    if (auto const claimed = claim(count); claimed) {
+                        pp.signal(claimed, efn);
+                    }
+                }
+            };
+
+
             /// Allow for an unlimited produer/consumer which never
             /// blocks due to the producer trying to send through too
-            /// much work.
-            class unlimited {
+            /// much work. `D` is the descriptor used for signalling.
+            template<typename D>
+            class basic_unlimited {
                 /// The IO service
                 boost::asio::io_service &service;
                 /// The file descriptor
-                pipe pp;
+                D pp;
+                /// How much each `consume` takes
+                const counting mode;
+                /// The amount produced but not yet consumed
+                std::atomic<uint64_t> m_available;
+                /// The consumers waiting for something to be produced
+                parking<D> consumers;
+
+                /// Take up to `most` from what is available. Returns zero
+                /// if there is nothing
+                uint64_t take(uint64_t most) {
+                    auto available = m_available.load();
+                    while (available) {
+                        auto const want = std::min(available, most);
+                        if (m_available.compare_exchange_weak(
+                                    available, available - want)) {
+                            return want;
+                        }
+                    }
+                    return 0;
+                }
+                /// The most that a single `consume` takes
+                uint64_t most() const {
+                    return mode == counting::semaphore
+                            ? 1u
+                            : std::numeric_limits<uint64_t>::max();
+                }
+                /// Wake up to `count` parked consumers
+                void wake(uint64_t count) {
+                    consumers.wake(count, [](auto error, auto bytes) {
+                        throw std::system_error(
+                                error.value(), std::generic_category(),
+                                std::string("Bytes ") + std::to_string(bytes));
+                    });
+                }
 
               public:
-                /// Constructs the producer/consumer channel
-                unlimited(boost::asio::io_service &ios)
-                : service(ios), pp(ios) {}
+                /// Constructs the producer/consumer channel. In semaphore
+                /// mode each `consume` returns one, so a burst of items
+                /// wakes one consumer per item. In counter mode `consume`
+                /// returns everything produced so far, which suits a single
+                /// consumer.
+                basic_unlimited(
+                        boost::asio::io_service &ios,
+                        counting c = counting::semaphore)
+                : service(ios),
+                  pp(ios, c),
+                  mode(c),
+                  m_available{},
+                  consumers(pp) {}
 
                 /// Return the IO service
                 boost::asio::io_service &get_io_service() { return service; }
+                /// The amount produced that hasn't yet been consumed
+                uint64_t available() const { return m_available.load(); }
 
                 /// Send the amount of work produced to the consumer
-                /// side.
+                /// side. The file descriptor is only written to if a
+                /// consumer is parked waiting for it.
                 void produced(uint64_t count = 1) {
-                    while (count) {
-                        unsigned char c = std::min(count, uint64_t{255});
-                        count -= c;
-                        boost::asio::async_write(
-                                pp, boost::asio::buffer(&c, 1),
-                                [](auto error, auto bytes) {
-                                    if (error) {
-                                        throw std::system_error(
-                                                error.value(),
-                                                std::generic_category(),
-                                                std::string("Bytes ")
-                                                        + std::to_string(bytes));
-                                    }
-                                });
-                    }
+                    m_available += count;
+                    wake(count);
                 }
                 /// Return how much to consume. Yields until there is
                 /// something available.
                 uint64_t consume(boost::asio::yield_context yield) {
-                    unsigned char c{};
-                    while (not c) {
-                        boost::asio::async_read(
-                                pp, boost::asio::buffer(&c, 1),
-                                boost::asio::transfer_exactly(1), yield);
+                    return consume(yield, most());
+                }
+                /// Return how much to consume, which is no more than
+                /// `max` whatever the counting mode. Yields until there is
+                /// something available. A `max` of zero is taken as one.
+                uint64_t consume(
+                        boost::asio::yield_context yield, uint64_t max) {
+                    max = std::max<uint64_t>(max, 1);
+                    while (true) {
+                        if (auto const got = take(max); got) {
+                            // If there is more then make sure a parked
+                            // consumer isn't left waiting for it
+                            if (m_available.load()) wake(1);
+                            return got;
+                        }
+                        try {
+                            consumers.park(
+                                    [this]() {
+                                        return m_available.load() > 0;
+                                    },
+                                    yield);
+                        } catch (boost::system::system_error &) {
+                            // Once closed anything that was produced
+                            // before then can still be consumed
+                            if (auto const got = take(max); got) return got;
+                            throw;
+                        }
                     }
-                    return c;
                 }
+                /// Return how much to consume without waiting. Returns
+                /// zero if nothing is available
+                uint64_t try_consume() { return take(most()); }
+                uint64_t try_consume(uint64_t max) { return take(max); }
 
                 /// Close the throttle
                 void close() { pp.close(); }
@@ -126,39 +354,58 @@ namespace f5 {
             /// Boost ASIO reactor. Jobs can be added up to a specified
             /// limit. If the limit is reached then the producer waits for
             /// the consumer to finish at least one job before starting up
-            /// again.
-            class limiter {
+            /// again. `D` is the descriptor used for signalling.
+            template<typename D>
+            class basic_limiter {
                 /// The IO service
                 boost::asio::io_service &service;
                 /// The file descriptor
-                pipe pp;
+                D pp;
                 /// The limit before we block waiting for some of the work
                 /// to complete.
                 std::atomic<uint64_t> m_limit;
                 /// The amount of outstanding work
                 std::atomic<uint64_t> m_outstanding;
+                /// The coroutines waiting for jobs to complete
+                parking<D> waiting;
 
-                /// Wait until at least one job has completed. Returns
-                /// the number of jobs that have completed.
-                uint64_t wait(boost::asio::yield_context yield) {
-                    unsigned char c{};
-                    while (not c) {
-                        boost::asio::async_read(
-                                pp, boost::asio::buffer(&c, 1),
-                                boost::asio::transfer_exactly(1), yield);
-                    }
-                    m_outstanding -= c;
-                    return c;
+                /// Wait for jobs to complete until the condition is true
+                template<typename C>
+                void wait_until(C condition, boost::asio::yield_context yield) {
+                    while (not condition()) waiting.park(condition, yield);
+                }
+                /// Return true if another job can be started
+                bool has_room() const {
+                    const auto limit = m_limit.load();
+                    return not limit || m_outstanding.load() < limit;
+                }
+                /// Record completed jobs and wake as many waiters
+                template<typename E>
+                void completed(uint64_t count, E efn) {
+                    m_outstanding -= count;
+                    waiting.wake(count, efn);
+                }
+                /// Wait until there is room for another job and then count it
+                void start(boost::asio::yield_context yield) {
+                    wait_until([this]() { return has_room(); }, yield);
+                    ++m_outstanding;
+                    // Several jobs may have completed for one wake up. If
+                    // there is still room then wake the next waiter
+                    if (has_room()) waiting.wake(1, [](auto, auto) {});
                 }
 
               public:
                 /// Construct with a given limit
-                limiter(boost::asio::io_service &ios, uint64_t limit)
-                : service(ios), pp(ios), m_limit(limit), m_outstanding{} {}
+                basic_limiter(boost::asio::io_service &ios, uint64_t limit)
+                : service(ios),
+                  pp(ios, counting::counter),
+                  m_limit(limit),
+                  m_outstanding{},
+                  waiting(pp) {}
                 /// The destructor ensures that there is no outstanding work
                 /// before it completes
                 void wait_for_all_outstanding(boost::asio::yield_context yield) {
-                    while (m_outstanding) wait(yield);
+                    wait_until([this]() { return not m_outstanding; }, yield);
                 }
 
                 /// Return the IO service
@@ -179,13 +426,13 @@ namespace f5 {
                     /// for reference counting. This is really a bit of a
                     /// waste as the job (probably) doesn't need to be
                     /// thread safe.
-                    friend class limiter;
+                    friend class basic_limiter;
                     /// Set to true when the job has been signalled
                     bool completed;
                     /// The limiter that owns this job
-                    limiter &limit;
+                    basic_limiter &limit;
                     /// Construct a new job
-                    job(limiter &l) : completed(false), limit(l) {}
+                    job(basic_limiter &l) : completed(false), limit(l) {}
 
                   public:
                     /// Make non-copyable
@@ -202,14 +449,7 @@ namespace f5 {
                     void done(E efn) {
                         if (!completed) {
                             completed = true;
-                            unsigned char count = 1;
-                            boost::asio::async_write(
-                                    limit.pp,
-                                    boost::asio::buffer(&count, sizeof(count)),
-                                    [efn](auto error, auto bytes) {
-                                        if (error || bytes != sizeof(uint64_t))
-                                            efn(error, bytes);
-                                    });
+                            limit.completed(1, efn);
                         }
                     }
                 };
@@ -217,13 +457,83 @@ namespace f5 {
 
                 /// Add another outstanding job and return it
                 std::unique_ptr<job> next_job(boost::asio::yield_context yield) {
+                    start(yield);
+                    return std::unique_ptr<job>(new job(*this));
+                }
+
+                /// A move only token for an outstanding job. Unlike `job` it
+                /// needs no allocation. The job is completed when the token
+                /// is destroyed or `done` is called.
+                class token {
+                    friend class basic_limiter;
+                    /// The limiter that owns this job. Null once the job
+                    /// has been completed or the token moved from
+                    basic_limiter *limit = nullptr;
+                    /// Construct a token for a new job
+                    explicit token(basic_limiter &l) : limit(&l) {}
+
+                  public:
+                    /// An empty token that doesn't represent any job
+                    token() = default;
+                    token(token &&t) noexcept
+                    : limit(std::exchange(t.limit, nullptr)) {}
+                    token &operator=(token &&t) noexcept {
+                        done();
+                        limit = std::exchange(t.limit, nullptr);
+                        return *this;
+                    }
+                    ~token() { done(); }
+
+                    /// Returns true if the job hasn't been completed
+                    explicit operator bool() const { return limit; }
+
+                    /// Signal that the job is completed, if not already
+                    /// done so
+                    void done() {
+                        done([](auto, auto) {});
+                    }
+                    template<typename E>
+                    void done(E efn) {
+                        if (limit) {
+                            std::exchange(limit, nullptr)->completed(1, efn);
+                        }
+                    }
+                };
+
+                /// Add another outstanding job and return a token for it
+                token next_token(boost::asio::yield_context yield) {
+                    start(yield);
+                    return token{*this};
+                }
+                /// Add another outstanding job only if there is room for it
+                /// now. Returns an empty token if there isn't
+                token try_next_token() {
+                    auto outstanding = m_outstanding.load();
                     while (true) {
-                        const auto limit = m_limit.load();
-                        if (not limit || m_outstanding.load() < limit) break;
-                        wait(yield);
+                        auto const limit = m_limit.load();
+                        if (limit && outstanding >= limit) return {};
+                        if (m_outstanding.compare_exchange_weak(
+                                    outstanding, outstanding + 1)) {
+                            return token{*this};
+                        }
                     }
-                    ++m_outstanding;
-                    return std::unique_ptr<job>(new job(*this));
+                }
+                /// Complete all of the jobs represented by the range of
+                /// tokens together. The outstanding count is updated once
+                /// and at most one signal is sent. Tokens from other
+                /// limiters and empty tokens are left untouched. Returns the
+                /// number of jobs completed
+                template<typename I>
+                uint64_t complete_all(I first, I last) {
+                    uint64_t count{};
+                    for (; first != last; ++first) {
+                        if (first->limit == this) {
+                            first->limit = nullptr;
+                            ++count;
+                        }
+                    }
+                    if (count) completed(count, [](auto, auto) {});
+                    return count;
                 }
 
                 /// Close it
@@ -231,6 +541,18 @@ namespace f5 {
             };
 
 
+#ifdef __linux__
+            /// The descriptor used for signalling by default
+            using signalling_descriptor = eventfd;
+#else
+            using signalling_descriptor = pipe;
+#endif
+            /// An unlimited producer/consumer using the default descriptor
+            using unlimited = basic_unlimited<signalling_descriptor>;
+            /// A limiter using the default descriptor
+            using limiter = basic_limiter<signalling_descriptor>;
+
+
         }
 
 
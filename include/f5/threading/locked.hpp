@@ -0,0 +1,222 @@
+/**
+    Copyright 2026 Red Anchor Trading Co. Ltd.
+
+    Distributed under the Boost Software License, Version 1.0.
+    See <http://www.boost.org/LICENSE_1_0.txt>
+ */
+
+
+#pragma once
+
+
+#include <f5/threading/map.hpp>
+
+#include <atomic>
+#include <thread>
+
+
+namespace f5 {
+
+
+    inline namespace threading {
+
+
+        /// A very small lock for protecting short critical sections. A
+        /// thread that can't get the lock yields rather than sleeping.
+        class spinlock {
+            std::atomic<bool> locked{false};
+
+          public:
+            void lock() {
+                while (locked.exchange(true, std::memory_order_acquire)) {
+                    while (locked.load(std::memory_order_relaxed)) {
+                        std::this_thread::yield();
+                    }
+                }
+            }
+            bool try_lock() {
+                return not locked.load(std::memory_order_relaxed)
+                        && not locked.exchange(true, std::memory_order_acquire);
+            }
+            void unlock() { locked.store(false, std::memory_order_release); }
+        };
+
+
+        /// Thread safe associative array (map) where each entry has its own
+        /// lock. The map's lock is only held for as long as it takes to find
+        /// (or add, or remove) an entry, and the entry's lock is held while
+        /// its value is used. Changes to different keys through `alter`
+        /// therefore don't block each other, or look ups.
+        ///
+        /// If an entry is removed whilst another thread is using it then
+        /// that thread will finish working on the removed value.
+        template<
+                typename K,
+                typename V,
+                typename P = typename container_default_policy<V>::type,
+                typename Mutex = std::mutex>
+        class tsmap_locked {
+            /// The entries stored in the map
+            struct entry {
+                spinlock lock;
+                V value;
+
+                template<typename... Args>
+                explicit entry(Args &&... args)
+                : value(std::forward<Args>(args)...) {}
+            };
+            using entry_ptr = std::shared_ptr<entry>;
+
+            /// The map that finds the entries
+            tsmap<K, entry_ptr, container_by_value_policy<entry_ptr>, Mutex>
+                    map;
+
+            /// Traits for controlling aspects of the implementation
+            using traits = P;
+
+          public:
+            /// Return an estimate of the size of the map.
+            std::size_t size() { return map.size(); }
+
+            /// Return a pointer to the value if found. If not found then
+            /// return `nullptr`
+            template<typename L>
+            typename traits::found_type find(const L &k) const {
+                if (auto e = map.find(k); e) {
+                    std::lock_guard<spinlock> lock(e->lock);
+                    return traits::found_from_V(e->value);
+                } else {
+                    return nullptr;
+                }
+            }
+            /// Return either the item in the map, or the passed in default.
+            template<typename L>
+            typename traits::found_type
+                    find(const L &k, typename traits::found_type d) const {
+                if (auto p = find(k); p)
+                    return p;
+                else
+                    return d;
+            }
+            /// Run the lambda on the found item with only the item locked.
+            /// Return true if the lambda was run.
+            template<typename L, typename F>
+            bool alter(L const &k, F lambda) {
+                if (auto e = map.find(k); e) {
+                    std::lock_guard<spinlock> lock(e->lock);
+                    lambda(traits::reference_from_V(e->value));
+                    return true;
+                } else {
+                    return false;
+                }
+            }
+
+            /// Ensures the item at the requested key is the value given
+            template<typename A>
+            typename traits::value_return_type
+                    insert_or_assign(const K &k, A a) {
+                bool added = false;
+                auto e = map.add_if_not_found(k, [&]() {
+                    added = true;
+                    return std::make_shared<entry>(std::move(a));
+                });
+                std::lock_guard<spinlock> lock(e->lock);
+                if (not added) e->value = std::move(a);
+                return traits::value_from_V(e->value);
+            }
+            /// Adds the item if the key is not found. If the key is found and
+            /// the predicate returns true then replaces the value with the
+            /// one returned by the lambda
+            template<typename C, typename F>
+            typename traits::value_return_type
+                    insert_or_assign_if(const K &k, C predicate, F lambda) {
+                bool added = false;
+                auto e = map.add_if_not_found(k, [&]() {
+                    added = true;
+                    return std::make_shared<entry>(lambda());
+                });
+                std::lock_guard<spinlock> lock(e->lock);
+                if (not added && predicate(e->value)) e->value = lambda();
+                return traits::value_from_V(e->value);
+            }
+            /// Adds a value at the key if there isn't one there already.
+            /// Returns a reference to the item
+            template<typename... Args>
+            typename traits::value_return_type
+                    emplace_if_not_found(const K &k, Args &&... args) {
+                auto e = map.add_if_not_found(k, [&]() {
+                    return std::make_shared<entry>(std::forward<Args>(args)...);
+                });
+                std::lock_guard<spinlock> lock(e->lock);
+                return traits::value_from_V(e->value);
+            }
+            /// Adds a value at the key if there isn't one there already.
+            /// Returns a reference to the newly constructed item. If
+            /// the item is already in the map then the second lambda is
+            /// executed with the item locked.
+            template<typename F, typename M>
+            typename traits::value_return_type
+                    add_if_not_found(const K &k, F lambda, M miss) {
+                bool added = false;
+                auto e = map.add_if_not_found(k, [&]() {
+                    added = true;
+                    return std::make_shared<entry>(lambda());
+                });
+                std::lock_guard<spinlock> lock(e->lock);
+                if (not added) miss(traits::reference_from_V(e->value));
+                return traits::value_from_V(e->value);
+            }
+            /// Adds a value at the key if there isn't one there already.
+            template<typename F>
+            typename traits::value_return_type
+                    add_if_not_found(const K &k, F lambda) {
+                return add_if_not_found(k, lambda, [](const auto &) {});
+            }
+
+            /// Iterate over the content of the map, locking each entry in
+            /// turn
+            template<typename F>
+            F for_each(F fn) const {
+                map.for_each([&fn](const K &k, const entry_ptr &e) {
+                    std::lock_guard<spinlock> lock(e->lock);
+                    fn(k, e->value);
+                });
+                return fn;
+            }
+            /// Iterate over the content of the map, releasing the map's lock
+            /// after each chunk of items
+            template<typename F>
+            F for_each_chunked(F fn, std::size_t chunk = 64) const {
+                map.for_each_chunked(
+                        [&fn](const K &k, const entry_ptr &e) {
+                            std::lock_guard<spinlock> lock(e->lock);
+                            fn(k, e->value);
+                        },
+                        chunk);
+                return fn;
+            }
+
+            /// Remove the requested key (if found). Returns true if the
+            /// key and its value were removed
+            bool remove(const K &k) { return map.remove(k); }
+
+            /// Removes values where the predicate is true. Returns how
+            /// many are left.
+            template<typename Pr>
+            std::size_t remove_if(Pr predicate) {
+                return map.remove_if(
+                        [&predicate](const K &k, const entry_ptr &e) {
+                            std::lock_guard<spinlock> lock(e->lock);
+                            return predicate(k, e->value);
+                        });
+            }
+
+            /// Remove all entries for the map
+            std::size_t clear() { return map.clear(); }
+        };
+
+
+    }
+
+
+}
@@ -1,5 +1,5 @@
 /**
-    Copyright 2015-2020 Red Anchor Trading Co. Ltd.
+    Copyright 2015-2026 Red Anchor Trading Co. Ltd.
 
     Distributed under the Boost Software License, Version 1.0.
     See <http://www.boost.org/LICENSE_1_0.txt>
@@ -10,10 +10,18 @@
 
 
 #include <algorithm>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <iterator>
 #include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <type_traits>
 #include <vector>
 
 #include <f5/threading/policy.hpp>
+#include <f5/threading/search.hpp>
 
 
 namespace f5 {
@@ -26,38 +34,119 @@ namespace f5 {
         template<
                 typename K,
                 typename V,
-                typename P = typename container_default_policy<V>::type>
+                typename P = typename container_default_policy<V>::type,
+                typename Mutex = std::mutex>
         class tsmap {
             /// Mutex used to control access to the vector
-            mutable std::mutex mutex;
+            mutable Mutex mutex;
             /// Vector which stores the data
             std::vector<std::pair<K, V>> map;
+            /// Index over the keys used to speed up searches
+            key_index<K> index;
 
             /// Traits for controlling aspects of the implementation
             using traits = P;
+            /// The lock used by members that only read the data
+            using read_lock = typename container_read_lock<Mutex>::type;
 
             /// Return the lower bound for the key
             template<typename L>
             auto lower_bound(const L &k) const {
-                return std::lower_bound(
-                        map.begin(), map.end(), k,
-                        [](const auto &l, const auto &r) {
-                            return l.first < r;
-                        });
+                return map.begin() + index.lower_bound(map, k);
             }
             template<typename L>
             auto lower_bound(const L &k) {
-                return std::lower_bound(
-                        map.begin(), map.end(), k,
+                return map.begin() + index.lower_bound(map, k);
+            }
+            /// Insert into the vector, keeping the key index up to date.
+            /// The index makes room first so that it can't fail once the
+            /// vector has changed
+            template<typename... Args>
+            auto emplace(
+                    typename std::vector<std::pair<K, V>>::iterator bound,
+                    Args &&... args) {
+                auto const i = bound - map.begin();
+                index.reserve(map.size() + 1);
+                auto pos = map.emplace(bound, std::forward<Args>(args)...);
+                index.insert(i, pos->first);
+                return pos;
+            }
+
+            /// Copy or move the key/value pairs in the range into a batch
+            /// sorted by key with only one entry per key. When there are
+            /// duplicate keys the last one is kept if `last_wins` is true,
+            /// otherwise the first one is kept.
+            template<typename R>
+            static std::vector<std::pair<K, V>>
+                    sorted_batch(R &&r, bool last_wins) {
+                std::vector<std::pair<K, V>> batch;
+                for (auto &&p : r) {
+                    if constexpr (std::is_rvalue_reference_v<R &&>) {
+                        batch.emplace_back(
+                                std::move(p.first), std::move(p.second));
+                    } else {
+                        batch.emplace_back(p.first, p.second);
+                    }
+                }
+                std::stable_sort(
+                        batch.begin(), batch.end(),
                         [](const auto &l, const auto &r) {
-                            return l.first < r;
+                            return l.first < r.first;
                         });
+                auto out = batch.begin();
+                for (auto in = batch.begin(); in != batch.end();) {
+                    auto const run = std::find_if(
+                            in, batch.end(),
+                            [&](const auto &p) { return in->first < p.first; });
+                    auto &keep = last_wins ? *(run - 1) : *in;
+                    if (&*out != &keep) *out = std::move(keep);
+                    ++out;
+                    in = run;
+                }
+                batch.erase(out, batch.end());
+                return batch;
+            }
+            /// Merge the sorted batch into the map in a single pass. If
+            /// `assign` is true then values in the batch replace values
+            /// already in the map. The lock must already be held. Returns
+            /// the number of keys that were added.
+            std::size_t
+                    merge(std::vector<std::pair<K, V>> batch, bool assign) {
+                index.reserve(map.size() + batch.size());
+                if (map.empty()) {
+                    map = std::move(batch);
+                    index.rebuild(map);
+                    return map.size();
+                }
+                std::vector<std::pair<K, V>> merged;
+                merged.reserve(map.size() + batch.size());
+                std::size_t added{};
+                auto m = map.begin();
+                auto b = batch.begin();
+                while (m != map.end() && b != batch.end()) {
+                    if (m->first < b->first) {
+                        merged.push_back(std::move(*m++));
+                    } else if (b->first < m->first) {
+                        merged.push_back(std::move(*b++));
+                        ++added;
+                    } else {
+                        merged.push_back(std::move(assign ? *b : *m));
+                        ++m;
+                        ++b;
+                    }
+                }
+                std::move(m, map.end(), std::back_inserter(merged));
+                added += batch.end() - b;
+                std::move(b, batch.end(), std::back_inserter(merged));
+                map.swap(merged);
+                index.rebuild(map);
+                return added;
             }
 
           public:
             /// Return an estimate of the size of the map.
             std::size_t size() {
-                std::unique_lock<std::mutex> lock(mutex);
+                read_lock lock(mutex);
                 return map.size();
             }
 
@@ -65,7 +154,7 @@ namespace f5 {
             /// return `nullptr`
             template<typename L>
             typename traits::found_type find(const L &k) const {
-                std::unique_lock<std::mutex> lock(mutex);
+                read_lock lock(mutex);
                 auto bound = lower_bound(k);
                 if (bound == map.end() || k != bound->first) {
                     return nullptr;
@@ -86,7 +175,7 @@ namespace f5 {
             /// was run.
             template<typename L, typename F>
             bool alter(L const &k, F lambda) {
-                std::unique_lock<std::mutex> lock(mutex);
+                std::unique_lock<Mutex> lock(mutex);
                 auto bound = lower_bound(k);
                 if (bound == map.end() || k != bound->first) {
                     return false;
@@ -100,7 +189,7 @@ namespace f5 {
             template<typename A>
             typename traits::value_return_type
                     insert_or_assign(const K &k, A a) {
-                std::unique_lock<std::mutex> lock(mutex);
+                std::unique_lock<Mutex> lock(mutex);
                 auto bound = lower_bound(k);
                 if (bound != map.end() && bound->first == k) {
                     // We have a cache hit, so assign
@@ -108,11 +197,11 @@ namespace f5 {
                 } else {
                     // We have a cache miss so insert
                     return traits::value_from_V(
-                            map.emplace(
-                                       bound, std::piecewise_construct,
-                                       std::forward_as_tuple(k),
-                                       std::forward_as_tuple(std::move(a)))
-                                    ->second);
+                            emplace(
+                                   bound, std::piecewise_construct,
+                                   std::forward_as_tuple(k),
+                                   std::forward_as_tuple(std::move(a)))
+                                ->second);
                 }
             }
             /// Adds the item if the key is not found. If the key is found and
@@ -121,7 +210,7 @@ namespace f5 {
             template<typename C, typename F>
             typename traits::value_return_type
                     insert_or_assign_if(const K &k, C predicate, F lambda) {
-                std::unique_lock<std::mutex> lock(mutex);
+                std::unique_lock<Mutex> lock(mutex);
                 auto bound = lower_bound(k);
                 if (bound != map.end() && bound->first == k) {
                     // Cache hit so check the predicate
@@ -133,18 +222,18 @@ namespace f5 {
                 }
                 // Cache miss, so use the lambda to get the value to insert
                 return traits::value_from_V(
-                        map.emplace(
-                                   bound, std::piecewise_construct,
-                                   std::forward_as_tuple(k),
-                                   std::forward_as_tuple(lambda()))
-                                ->second);
+                        emplace(
+                               bound, std::piecewise_construct,
+                               std::forward_as_tuple(k),
+                               std::forward_as_tuple(lambda()))
+                            ->second);
             }
             /// Adds a value at the key if there isn't one there already.
             /// Returns a reference to the item
             template<typename... Args>
             typename traits::value_return_type
                     emplace_if_not_found(const K &k, Args &&... args) {
-                std::unique_lock<std::mutex> lock(mutex);
+                std::unique_lock<Mutex> lock(mutex);
                 auto bound = lower_bound(k);
                 if (bound != map.end() && bound->first == k) {
                     // A cache hit, so return what we have
@@ -152,12 +241,12 @@ namespace f5 {
                 }
                 // Insert before returning the new value
                 return traits::value_from_V(
-                        map.emplace(
-                                   bound, std::piecewise_construct,
-                                   std::forward_as_tuple(k),
-                                   std::forward_as_tuple(
-                                           std::forward<Args>(args)...))
-                                ->second);
+                        emplace(
+                               bound, std::piecewise_construct,
+                               std::forward_as_tuple(k),
+                               std::forward_as_tuple(
+                                       std::forward<Args>(args)...))
+                            ->second);
             }
             /// Adds a value at the key if there isn't one there already.
             /// Returns a reference to the newly constructed item. If
@@ -166,7 +255,7 @@ namespace f5 {
             template<typename F, typename M>
             typename traits::value_return_type
                     add_if_not_found(const K &k, F lambda, M miss) {
-                std::unique_lock<std::mutex> lock(mutex);
+                std::unique_lock<Mutex> lock(mutex);
                 auto bound = lower_bound(k);
                 if (bound != map.end() && bound->first == k) {
                     // Cache hit so don't run the lambda
@@ -175,11 +264,11 @@ namespace f5 {
                 }
                 // Cache miss, so use the lambda to get the value to insert
                 return traits::value_from_V(
-                        map.emplace(
-                                   bound, std::piecewise_construct,
-                                   std::forward_as_tuple(k),
-                                   std::forward_as_tuple(lambda()))
-                                ->second);
+                        emplace(
+                               bound, std::piecewise_construct,
+                               std::forward_as_tuple(k),
+                               std::forward_as_tuple(lambda()))
+                            ->second);
             }
             /// Adds a value at the key if there isn't one there already.
             template<typename F>
@@ -188,24 +277,102 @@ namespace f5 {
                 return add_if_not_found(k, lambda, [](const auto &) {});
             }
 
+            /// Look up a batch of keys, which must be in ascending order,
+            /// whilst only taking the lock once. The result of `find` for
+            /// each key is written to the output iterator, which is returned.
+            template<typename I, typename O>
+            O find_many(I first, I last, O out) const {
+                read_lock lock(mutex);
+                std::size_t from{};
+                for (; first != last; ++first) {
+                    from = index.lower_bound(map, *first, from);
+                    auto const bound = map.begin() + from;
+                    if (bound == map.end() || *first != bound->first) {
+                        *out++ = typename traits::found_type{nullptr};
+                    } else {
+                        *out++ = traits::found_from_V(bound->second);
+                    }
+                }
+                return out;
+            }
+
+            /// Add the key/value pairs from the range whose keys are not
+            /// already in the map. The items are sorted before the lock is
+            /// taken and then merged into the map in one pass. If the range
+            /// is an rvalue then its items are moved from. Returns the
+            /// number of items added.
+            template<typename R>
+            std::size_t insert_range(R &&r) {
+                auto batch = sorted_batch(std::forward<R>(r), false);
+                std::unique_lock<Mutex> lock(mutex);
+                return merge(std::move(batch), false);
+            }
+            /// Ensures that every key in the range maps to the value given
+            /// with it, as `insert_or_assign` would. If a key is repeated
+            /// in the range the last value is used. Returns the number of
+            /// items added.
+            template<typename R>
+            std::size_t assign_range(R &&r) {
+                auto batch = sorted_batch(std::forward<R>(r), true);
+                std::unique_lock<Mutex> lock(mutex);
+                return merge(std::move(batch), true);
+            }
+
             /// Iterate over the content of the map
             template<typename F>
             F for_each(F fn) const {
-                std::unique_lock<std::mutex> lock(mutex);
+                read_lock lock(mutex);
                 std::for_each(map.begin(), map.end(), [fn](const auto &v) {
                     fn(v.first, v.second);
                 });
-                return std::move(fn);
+                return fn;
+            }
+            /// Iterate over the content of the map without holding the lock
+            /// for the whole walk. The lock is held while at most `chunk`
+            /// items are passed to the function and then released so that
+            /// writers can make progress. Keys are visited in order and each
+            /// at most once, but items added or removed during the walk may
+            /// or may not be seen. The function must not use the map.
+            template<typename F>
+            F for_each_chunked(F fn, std::size_t chunk = 64) const {
+                chunk = std::max<std::size_t>(chunk, 1);
+                std::optional<K> last;
+                while (true) {
+                    read_lock lock(mutex);
+                    auto pos = map.begin();
+                    if (last) {
+                        pos = lower_bound(*last);
+                        if (pos != map.end() && not(*last < pos->first)) ++pos;
+                    }
+                    if (pos == map.end()) return fn;
+                    auto const end = std::size_t(map.end() - pos) > chunk
+                            ? pos + chunk
+                            : map.end();
+                    for (; pos != end; ++pos) fn(pos->first, pos->second);
+                    last = std::prev(end)->first;
+                }
+            }
+            /// Iterate over the items whose keys are not less than `lo` and
+            /// are less than `hi`, in order
+            template<typename L, typename H, typename F>
+            F for_each_range(const L &lo, const H &hi, F fn) const {
+                read_lock lock(mutex);
+                for (auto pos = lower_bound(lo);
+                     pos != map.end() && pos->first < hi; ++pos) {
+                    fn(pos->first, pos->second);
+                }
+                return fn;
             }
 
             /// Remove the requested key (if found). Returns true if the
             /// key and its value were removed
             bool remove(const K &k) {
-                std::unique_lock<std::mutex> lock(mutex);
+                std::unique_lock<Mutex> lock(mutex);
                 auto bound = lower_bound(k);
-                if (bound == map.end())
+                if (bound == map.end() || k != bound->first)
                     return false;
                 else {
+                    index.erase(bound - map.begin());
                     map.erase(bound);
                     return true;
                 }
@@ -215,7 +382,7 @@ namespace f5 {
             /// many are left.
             template<typename Pr>
             std::size_t remove_if(Pr predicate) {
-                std::unique_lock<std::mutex> lock(mutex);
+                std::unique_lock<Mutex> lock(mutex);
                 map.erase(
                         std::remove_if(
                                 map.begin(), map.end(),
@@ -223,19 +390,263 @@ namespace f5 {
                                     return predicate(v.first, v.second);
                                 }),
                         map.end());
+                index.rebuild(map);
                 return map.size();
             }
 
             /// Remove all entries for the map
             std::size_t clear() {
-                std::unique_lock<std::mutex> lock(mutex);
+                std::unique_lock<Mutex> lock(mutex);
                 const auto r = map.size();
                 map.clear();
+                index.clear();
                 return r;
             }
         };
 
 
+        /// A `tsmap` where lookups and iteration share the lock and only
+        /// the members that change the map take it exclusively
+        template<
+                typename K,
+                typename V,
+                typename P = typename container_default_policy<V>::type>
+        using tsmap_rw = tsmap<K, V, P, std::shared_mutex>;
+
+
+        /// Thread safe associative array which spreads its keys across a
+        /// number of independently locked `tsmap` shards. Operations on a
+        /// single key only lock the shard that the key hashes to.
+        ///
+        /// Every lookup is hashed with `H`, as in `tshashmap`, so a lookup
+        /// with a type other than `K` either needs a transparent `H` or is
+        /// converted to `K`.
+        template<
+                typename K,
+                typename V,
+                typename P = typename container_default_policy<V>::type,
+                std::size_t Shards = 16,
+                typename Mutex = std::mutex,
+                typename H = std::hash<K>>
+        class tsmap_sharded {
+            static_assert(Shards > 0, "There must be at least one shard");
+
+            /// The type of each shard
+            using shard_type = tsmap<K, V, P, Mutex>;
+            /// The shards which store the data
+            std::array<shard_type, Shards> shards;
+
+            /// Traits for controlling aspects of the implementation
+            using traits = P;
+
+            /// Return the index of the shard that the key belongs in. The
+            /// hash is mixed using Fibonacci hashing first so that poor
+            /// hashes (like those for integers) don't all land in one shard
+            /// when the keys share a stride.
+            template<typename L>
+            static std::size_t shard_index(const L &k) {
+                const std::uint64_t h = H{}(k);
+                const std::uint64_t mixed = (h * 0x9e3779b97f4a7c15u) >> 32u;
+                return (mixed * Shards) >> 32u;
+            }
+            /// Return the shard that the key belongs in
+            template<typename L>
+            shard_type &shard(const L &k) {
+                return shards[shard_index(k)];
+            }
+            template<typename L>
+            const shard_type &shard(const L &k) const {
+                return shards[shard_index(k)];
+            }
+
+            /// Split the range into one batch per shard and pass each
+            /// shard and its batch to the function. Returns the sum of
+            /// what the function returns.
+            template<typename R, typename F>
+            std::size_t distribute(R &&r, F fn) {
+                std::array<std::vector<std::pair<K, V>>, Shards> batches;
+                for (auto &&p : r) {
+                    auto &batch = batches[shard_index(p.first)];
+                    if constexpr (std::is_rvalue_reference_v<R &&>) {
+                        batch.emplace_back(
+                                std::move(p.first), std::move(p.second));
+                    } else {
+                        batch.emplace_back(p.first, p.second);
+                    }
+                }
+                std::size_t s{};
+                for (std::size_t i{}; i < Shards; ++i) {
+                    if (batches[i].size()) {
+                        s += fn(shards[i], std::move(batches[i]));
+                    }
+                }
+                return s;
+            }
+
+          public:
+            /// The number of shards the keys are spread over
+            static constexpr std::size_t shard_count = Shards;
+            /// Return the index of the shard that the key is stored in
+            template<typename L>
+            static std::size_t shard_of(const L &k) {
+                return shard_index(k);
+            }
+
+            /// Return an estimate of the size of the map.
+            std::size_t size() {
+                std::size_t s{};
+                for (auto &m : shards) s += m.size();
+                return s;
+            }
+
+            /// Return a pointer to the value if found. If not found then
+            /// return `nullptr`
+            template<typename L>
+            typename traits::found_type find(const L &k) const {
+                return shard(k).find(k);
+            }
+            /// Return either the item in the map, or the passed in default.
+            template<typename L>
+            typename traits::found_type
+                    find(const L &k, typename traits::found_type d) const {
+                return shard(k).find(k, std::move(d));
+            }
+            /// Run the lambda on the found item. Return true if the lambda
+            /// was run.
+            template<typename L, typename F>
+            bool alter(L const &k, F lambda) {
+                return shard(k).alter(k, std::move(lambda));
+            }
+
+            /// Ensures the item at the requested key is the value given
+            template<typename A>
+            typename traits::value_return_type
+                    insert_or_assign(const K &k, A a) {
+                return shard(k).insert_or_assign(k, std::move(a));
+            }
+            /// Adds the item if the key is not found. If the key is found and
+            /// the predicate returns true then replaces the value with the
+            /// one returned by the lambda
+            template<typename C, typename F>
+            typename traits::value_return_type
+                    insert_or_assign_if(const K &k, C predicate, F lambda) {
+                return shard(k).insert_or_assign_if(
+                        k, std::move(predicate), std::move(lambda));
+            }
+            /// Adds a value at the key if there isn't one there already.
+            /// Returns a reference to the item
+            template<typename... Args>
+            typename traits::value_return_type
+                    emplace_if_not_found(const K &k, Args &&... args) {
+                return shard(k).emplace_if_not_found(
+                        k, std::forward<Args>(args)...);
+            }
+            /// Adds a value at the key if there isn't one there already.
+            /// Returns a reference to the newly constructed item. If
+            /// the item is already in the map then the second lambda is
+            /// executed.
+            template<typename F, typename M>
+            typename traits::value_return_type
+                    add_if_not_found(const K &k, F lambda, M miss) {
+                return shard(k).add_if_not_found(
+                        k, std::move(lambda), std::move(miss));
+            }
+            /// Adds a value at the key if there isn't one there already.
+            template<typename F>
+            typename traits::value_return_type
+                    add_if_not_found(const K &k, F lambda) {
+                return shard(k).add_if_not_found(k, std::move(lambda));
+            }
+
+            /// Look up a batch of keys, which must be in ascending order. The
+            /// keys are grouped by shard and each shard is locked once. The
+            /// result of `find` for each key is written to the output
+            /// iterator in the order of the keys, and the iterator is
+            /// returned.
+            template<typename I, typename O>
+            O find_many(I first, I last, O out) const {
+                using key_type = typename std::iterator_traits<I>::value_type;
+                using found_type = typename traits::found_type;
+                std::array<std::vector<key_type>, Shards> keys;
+                std::array<std::vector<std::size_t>, Shards> positions;
+                std::size_t n{};
+                for (; first != last; ++first, ++n) {
+                    auto const s = shard_index(*first);
+                    keys[s].push_back(*first);
+                    positions[s].push_back(n);
+                }
+                std::vector<found_type> found(n, found_type{nullptr});
+                std::vector<found_type> batch;
+                for (std::size_t s{}; s < Shards; ++s) {
+                    if (keys[s].empty()) continue;
+                    batch.clear();
+                    shards[s].find_many(
+                            keys[s].begin(), keys[s].end(),
+                            std::back_inserter(batch));
+                    for (std::size_t i{}; i < batch.size(); ++i) {
+                        found[positions[s][i]] = std::move(batch[i]);
+                    }
+                }
+                return std::move(found.begin(), found.end(), out);
+            }
+
+            /// Add the key/value pairs from the range whose keys are not
+            /// already in the map. Each shard is locked once. Returns the
+            /// number of items added.
+            template<typename R>
+            std::size_t insert_range(R &&r) {
+                return distribute(std::forward<R>(r), [](auto &m, auto b) {
+                    return m.insert_range(std::move(b));
+                });
+            }
+            /// Ensures that every key in the range maps to the value given
+            /// with it. Each shard is locked once. Returns the number of
+            /// items added.
+            template<typename R>
+            std::size_t assign_range(R &&r) {
+                return distribute(std::forward<R>(r), [](auto &m, auto b) {
+                    return m.assign_range(std::move(b));
+                });
+            }
+
+            /// Iterate over the content of the map. Each shard is locked in
+            /// turn, so the keys are only ordered within a shard and the
+            /// iteration is not an atomic view of the whole map.
+            template<typename F>
+            F for_each(F fn) const {
+                for (auto &m : shards) m.for_each(std::ref(fn));
+                return fn;
+            }
+            /// Iterate over the content of each shard in turn, releasing the
+            /// shard's lock after each chunk of items
+            template<typename F>
+            F for_each_chunked(F fn, std::size_t chunk = 64) const {
+                for (auto &m : shards) m.for_each_chunked(std::ref(fn), chunk);
+                return fn;
+            }
+
+            /// Remove the requested key (if found). Returns true if the
+            /// key and its value were removed
+            bool remove(const K &k) { return shard(k).remove(k); }
+
+            /// Removes values where the predicate is true. Returns how
+            /// many are left.
+            template<typename Pr>
+            std::size_t remove_if(Pr predicate) {
+                std::size_t s{};
+                for (auto &m : shards) s += m.remove_if(predicate);
+                return s;
+            }
+
+            /// Remove all entries for the map
+            std::size_t clear() {
+                std::size_t s{};
+                for (auto &m : shards) s += m.clear();
+                return s;
+            }
+        };
+
+
     }
 
 
@@ -1,5 +1,5 @@
 /**
-    Copyright 2015-2020 Red Anchor Trading Co. Ltd.
+    Copyright 2015-2026 Red Anchor Trading Co. Ltd.
 
     Distributed under the Boost Software License, Version 1.0.
     See <http://www.boost.org/LICENSE_1_0.txt>
@@ -9,6 +9,8 @@
 #pragma once
 
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
 
 
 namespace f5 {
@@ -46,12 +48,12 @@ namespace f5 {
         template<typename V>
         struct weak_ptr_promotion_policy {
             using found_type = decltype(std::declval<V>().lock());
-            using reference_type = std::add_lvalue_reference_t<found_type>;
+            using reference_type = std::add_lvalue_reference_t<V>;
             using value_return_type = decltype(std::declval<V>().lock());
 
             static found_type found_from_V(V v) { return v.lock(); }
             static value_return_type value_from_V(V v) { return v.lock(); }
-            static reference_type reference_from_V(V v) { return v.lock(); }
+            static reference_type reference_from_V(V &v) { return v; }
         };
 
         /// Use the values by default in the container interface
@@ -71,6 +73,24 @@ namespace f5 {
         };
 
 
+        /// The lock taken by containers for read only access when they
+        /// are protected by a mutex of type `M`. Exclusive by default
+        template<typename M>
+        struct container_read_lock {
+            using type = std::unique_lock<M>;
+        };
+        /// Readers share the lock when a `std::shared_mutex` is used
+        template<>
+        struct container_read_lock<std::shared_mutex> {
+            using type = std::shared_lock<std::shared_mutex>;
+        };
+        /// Readers share the lock when a `std::shared_timed_mutex` is used
+        template<>
+        struct container_read_lock<std::shared_timed_mutex> {
+            using type = std::shared_lock<std::shared_timed_mutex>;
+        };
+
+
     }
 
 
@@ -0,0 +1,210 @@
+/**
+    Copyright 2026 Red Anchor Trading Co. Ltd.
+
+    Distributed under the Boost Software License, Version 1.0.
+    See <http://www.boost.org/LICENSE_1_0.txt>
+ */
+
+
+#pragma once
+
+
+#include <f5/threading/weighted.hpp>
+
+#include <boost/asio/io_service.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+
+namespace f5 {
+
+
+    namespace boost_asio {
+
+
+        /// Waiting coroutines grouped into priority classes, where class
+        /// zero is the highest priority. Within a class coroutines are
+        /// served in the order they arrived. The class served next is
+        /// either the highest priority one with anything waiting, or, when
+        /// the classes have shares, chosen by stride scheduling.
+        class priority_order {
+            /// The waiters and scheduling state for a priority class
+            struct priority_class {
+                std::deque<std::shared_ptr<limiter_waiter>> waiting;
+                /// The amount the class's pass moves on for each job
+                /// started. Zero for strict priority
+                uint64_t stride = {};
+                /// The class with the lowest pass goes next
+                uint64_t pass = {};
+            };
+            std::vector<priority_class> classes;
+            /// The pass of the most recently started job. A class that
+            /// has been idle starts from here so that it can't bank time
+            uint64_t global_pass = {};
+
+            /// Return true if pass `a` comes before pass `b`. The passes
+            /// only ever grow, and the live ones stay close together, so
+            /// comparing their difference keeps working once they wrap
+            static bool earlier(uint64_t a, uint64_t b) {
+                return int64_t(a - b) < 0;
+            }
+            /// The class whose waiter should start next, or `nullptr` if
+            /// nothing is waiting
+            const priority_class *next_class() const {
+                const priority_class *best = nullptr;
+                for (auto &c : classes) {
+                    if (c.waiting.size()
+                        && (not best || earlier(c.pass, best->pass))) {
+                        best = &c;
+                    }
+                    // With strict priority the first waiting class wins
+                    if (best && not best->stride) break;
+                }
+                return best;
+            }
+
+          public:
+            /// The priority class to queue a waiter in
+            using place = std::size_t;
+
+            /// Construct with the number of classes served by strict
+            /// priority
+            explicit priority_order(std::size_t priorities)
+            : classes(priorities) {
+                if (classes.empty()) {
+                    throw std::invalid_argument(
+                            "There must be at least one priority class");
+                }
+            }
+            /// Construct with a share for each class. A share of zero is
+            /// treated as one
+            explicit priority_order(const std::vector<uint64_t> &shares)
+            : priority_order(shares.size()) {
+                auto constexpr scale = std::numeric_limits<uint32_t>::max();
+                for (std::size_t c{}; c < shares.size(); ++c) {
+                    classes[c].stride =
+                            scale / std::max<uint64_t>(shares[c], 1);
+                }
+            }
+
+            /// The number of priority classes
+            std::size_t size() const { return classes.size(); }
+
+            void push(place p, std::shared_ptr<limiter_waiter> w) {
+                auto &c = classes.at(p);
+                if (c.waiting.empty() && earlier(c.pass, global_pass)) {
+                    c.pass = global_pass;
+                }
+                c.waiting.push_back(std::move(w));
+            }
+            limiter_waiter *next() const {
+                auto const c = next_class();
+                return c ? c->waiting.front().get() : nullptr;
+            }
+            void pop() {
+                auto &c = classes[next_class() - classes.data()];
+                c.waiting.pop_front();
+                global_pass = c.pass;
+                c.pass += c.stride;
+            }
+            void erase(const std::shared_ptr<limiter_waiter> &w) {
+                for (auto &c : classes) {
+                    auto const pos =
+                            std::find(c.waiting.begin(), c.waiting.end(), w);
+                    if (pos != c.waiting.end()) {
+                        c.waiting.erase(pos);
+                        return;
+                    }
+                }
+            }
+            std::vector<std::shared_ptr<limiter_waiter>> take_all() {
+                std::vector<std::shared_ptr<limiter_waiter>> all;
+                for (auto &c : classes) {
+                    std::move(
+                            c.waiting.begin(), c.waiting.end(),
+                            std::back_inserter(all));
+                    c.waiting.clear();
+                }
+                return all;
+            }
+        };
+
+
+        /// A limiter on the number of outstanding jobs where each job
+        /// belongs to a priority class. Class zero is the highest priority.
+        /// When capacity is freed it goes to a waiting job chosen by the
+        /// class, and within a class jobs start in the order they arrived.
+        ///
+        /// By default the choice is by strict priority, so a waiting job in
+        /// a lower class only starts once no higher class has anything
+        /// waiting. Alternatively each class can be given a share, and the
+        /// freed capacity is then divided between the waiting classes in
+        /// proportion to their shares (stride scheduling), which means low
+        /// priority work is never starved.
+        class priority_limiter : public basic_weighted_limiter<priority_order> {
+          public:
+            /// Construct with the given limit and number of classes served
+            /// by strict priority
+            priority_limiter(
+                    boost::asio::io_service &ios,
+                    uint64_t limit,
+                    std::size_t priorities = 2)
+            : basic_weighted_limiter(ios, limit, priorities) {}
+            /// Construct with the given limit and a share for each class.
+            /// Waiting classes receive capacity in proportion to their
+            /// shares. A share of zero is treated as one
+            priority_limiter(
+                    boost::asio::io_service &ios,
+                    uint64_t limit,
+                    const std::vector<uint64_t> &shares)
+            : basic_weighted_limiter(ios, limit, shares) {}
+
+            /// The number of priority classes
+            std::size_t priorities() const { return queue().size(); }
+
+            /// Add another outstanding job in the given priority class. The
+            /// coroutine is suspended until the job can start. Throws if the
+            /// limiter is closed
+            template<typename Y>
+            token next_token(std::size_t priority, Y yield) {
+                check(priority);
+                return acquire(1, priority, yield);
+            }
+            /// Add another outstanding job in the lowest priority class
+            template<typename Y>
+            token next_token(Y yield) {
+                return next_token(priorities() - 1, yield);
+            }
+
+            /// Add another outstanding job in the given priority class only
+            /// if it can start now. Returns an empty token if it can't
+            token try_next_token(std::size_t priority) {
+                check(priority);
+                return try_acquire(1);
+            }
+            /// Add another outstanding job in the lowest priority class only
+            /// if it can start now
+            token try_next_token() { return try_acquire(1); }
+
+          private:
+            /// Throw if there is no such priority class. The number of
+            /// classes never changes so no lock is needed
+            void check(std::size_t priority) const {
+                if (priority >= priorities()) {
+                    throw std::out_of_range("No such priority class");
+                }
+            }
+        };
+
+    }
+
+
+}
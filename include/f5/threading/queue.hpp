@@ -1,5 +1,5 @@
 /**
-    Copyright 2017-2019 Red Anchor Trading Co. Ltd.
+    Copyright 2017-2026 Red Anchor Trading Co. Ltd.
 
     Distributed under the Boost Software License, Version 1.0.
     See <http://www.boost.org/LICENSE_1_0.txt>
@@ -10,10 +10,19 @@
 
 
 #include <f5/threading/limiters.hpp>
+#include <f5/threading/segmented.hpp>
+#include <f5/threading/suspend.hpp>
 
+#include <boost/circular_buffer.hpp>
+
+#include <algorithm>
+#include <atomic>
 #include <deque>
 #include <optional>
 #include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 
 namespace f5 {
@@ -22,26 +31,68 @@ namespace f5 {
     namespace boost_asio {
 
 
+        /// True for a store type that is itself safe to use from many
+        /// threads at once, such as `segmented_store`. It must provide
+        /// `push_back` and `try_pop_front` and set `concurrent`
+        template<typename S, typename = void>
+        inline constexpr bool concurrent_store = false;
+        template<typename S>
+        inline constexpr bool
+                concurrent_store<S, std::void_t<decltype(S::concurrent)>> =
+                        S::concurrent;
+
+
         /// A producer/consumer queue compatible with Boost.ASIO and
         /// coroutines. In this queue design the producers may always
         /// enque items into the queue without having to wait for the
         /// consumer to make room. For a capacity limited version of a
         /// similar concept see channel.
+        ///
+        /// Each item produced adds one to the count in `signal` after it
+        /// has been stored, and a consumer takes one from the count before
+        /// it removes an item. Taking from the count claims an item, so the
+        /// consumer never has to check whether another consumer got there
+        /// first. With a concurrent store such as `segmented_store` the
+        /// queue has no lock of its own.
         template<typename T, typename S = std::deque<T>>
         class queue {
-            /// Mutex that controls access to the queue items
+            /// Mutex that controls access to the queue items. Not used
+            /// for a concurrent store
             std::mutex exclusive;
             /// The current queue content
             S items;
             /// Communication between producer and consumer about how
             /// many items are in the channel
             threading::fd::unlimited signal;
-            /// Return and pop the head of the deque. There must already
-            /// be a lock covering the deque
+            /// Coroutines, such as those in `consume_any`, to be resumed
+            /// when anything is produced. Guarded by `exclusive`
+            std::vector<resumer> watchers;
+            /// Set while there are watchers, so that producers only take
+            /// the lock when they need to
+            std::atomic<bool> watched{false};
+            /// Set once the queue has been closed
+            std::atomic<bool> m_closed{false};
+            /// Resume the watchers after an item has been produced
+            void notify() {
+                if (not watched.load()) return;
+                std::unique_lock<std::mutex> lock{exclusive};
+                auto ready = std::move(watchers);
+                watchers.clear();
+                watched = false;
+                lock.unlock();
+                for (auto &r : ready) r();
+            }
+            /// Return and pop the head of the store. An item must already
+            /// have been claimed from `signal`
             T pop_head() {
-                auto ret = std::move(items.front());
-                items.pop_front();
-                return ret;
+                if constexpr (concurrent_store<S>) {
+                    return std::move(*items.try_pop_front());
+                } else {
+                    std::lock_guard<std::mutex> lock{exclusive};
+                    auto ret = std::move(items.front());
+                    items.pop_front();
+                    return ret;
+                }
             }
 
           public:
@@ -51,46 +102,212 @@ namespace f5 {
             using value_type = T;
 
             /// Construct for the specified IO service
-            queue(boost::asio::io_service &ios, S s = S())
+            explicit queue(boost::asio::io_service &ios) : signal{ios} {}
+            /// Construct for the specified IO service using the given
+            /// store
+            queue(boost::asio::io_service &ios, S s)
             : items(std::move(s)), signal{ios} {}
 
+            /// Return the IO service
+            boost::asio::io_service &get_io_service() {
+                return signal.get_io_service();
+            }
+            /// True if there is nothing waiting to be consumed
+            bool empty() const { return not signal.available(); }
+            /// True once the queue has been closed
+            bool closed() const { return m_closed.load(); }
+
             /// Produce an item to be consued
             void produce(T t) {
-                std::unique_lock<std::mutex> lock{exclusive};
-                items.push_back(std::move(t));
-                lock.unlock();
+                if constexpr (concurrent_store<S>) {
+                    items.push_back(std::move(t));
+                } else {
+                    std::lock_guard<std::mutex> lock{exclusive};
+                    items.push_back(std::move(t));
+                }
                 signal.produced();
+                notify();
+            }
+
+            /// Produce all of the items in the range with a single lock
+            /// and a single signal. Items are moved from an rvalue range.
+            /// Returns the number of items produced
+            template<typename R>
+            std::size_t produce_many(R &&range) {
+                std::size_t count{};
+                std::unique_lock<std::mutex> lock{exclusive, std::defer_lock};
+                if constexpr (not concurrent_store<S>) lock.lock();
+                for (auto &v : range) {
+                    if constexpr (std::is_rvalue_reference_v<R &&>) {
+                        items.push_back(std::move(v));
+                    } else {
+                        items.push_back(v);
+                    }
+                    ++count;
+                }
+                if (lock) lock.unlock();
+                if (count) {
+                    signal.produced(count);
+                    notify();
+                }
+                return count;
             }
 
             /// Consume an item, block the coroutine until one becomes
             /// available.
             T consume(boost::asio::yield_context yield) {
-                while (true) {
-                    auto check_size = [this]() {
-                        std::unique_lock<std::mutex> lock{exclusive};
-                        return items.size();
-                    };
-                    while (not check_size()) { signal.consume(yield); }
+                signal.consume(yield);
+                return pop_head();
+            }
+            /// Consume up to `max` items, blocking the coroutine until at
+            /// least one is available. The items are claimed together and
+            /// removed under a single lock. A `max` of zero consumes one
+            std::vector<T> consume_many(
+                    boost::asio::yield_context yield, std::size_t max) {
+                auto const claimed = signal.consume(yield, max);
+                std::vector<T> got;
+                got.reserve(claimed);
+                if constexpr (concurrent_store<S>) {
+                    for (std::size_t n{}; n < claimed; ++n) {
+                        got.push_back(std::move(*items.try_pop_front()));
+                    }
+                } else {
                     std::lock_guard<std::mutex> lock{exclusive};
-                    /// We need to recheck for there being items again
-                    /// because we released the lock above and another
-                    /// thread could have come in and stolen the item.
-                    /// If there isn't one we'll loop around again until
-                    /// there is.
-                    if (items.size()) { return pop_head(); }
+                    for (std::size_t n{}; n < claimed; ++n) {
+                        got.push_back(std::move(items.front()));
+                        items.pop_front();
+                    }
                 }
+                return got;
             }
             /// Return a job if one is available
             std::optional<T> consume() {
-                std::unique_lock<std::mutex> lock{exclusive};
-                if (items.size()) {
+                if (signal.try_consume()) {
                     return pop_head();
                 } else {
                     return {};
                 }
             }
 
-            /// Close the queue
+            /// Resume the coroutine the next time anything is produced.
+            /// The resumer is only used once
+            void watch(resumer r) {
+                std::lock_guard<std::mutex> lock{exclusive};
+                watchers.push_back(std::move(r));
+                watched = true;
+            }
+            /// Stop watching for items, if the resumer hasn't been used
+            void unwatch(const resumer &r) {
+                std::lock_guard<std::mutex> lock{exclusive};
+                watchers.erase(
+                        std::remove(watchers.begin(), watchers.end(), r),
+                        watchers.end());
+                watched = not watchers.empty();
+            }
+
+            /// Close the queue. Watching coroutines are resumed so that
+            /// they can see that it has been closed
+            void close() {
+                m_closed = true;
+                signal.close();
+                std::unique_lock<std::mutex> lock{exclusive};
+                auto ready = std::move(watchers);
+                watchers.clear();
+                watched = false;
+                lock.unlock();
+                for (auto &r : ready) r();
+            }
+        };
+
+
+        /// A producer/consumer ring buffer compatible with Boost.ASIO and
+        /// coroutines. Like `tsring` it has a fixed number of slots and
+        /// when full the oldest item is overwritten, so producers never
+        /// wait. Consumers can suspend until an item arrives.
+        template<typename T>
+        class ring {
+            /// Mutex that controls access to the ring items
+            std::mutex exclusive;
+            /// The current ring content
+            boost::circular_buffer<T> items;
+            /// Communication between producer and consumer about how
+            /// many items are in the ring. A consumer claims an item from
+            /// this before taking it, and overwriting an item doesn't add
+            /// to it, so there is always an item for each claim
+            threading::fd::unlimited signal;
+            /// Return and pop the head of the ring. There must already
+            /// be a lock covering the ring
+            T pop_head() {
+                auto ret = std::move(items.front());
+                items.pop_front();
+                return ret;
+            }
+
+          public:
+            /// The type of item that is put in the ring
+            using value_type = T;
+
+            /// Construct for the specified IO service with the specified
+            /// number of slots
+            ring(boost::asio::io_service &ios, std::size_t s)
+            : items(s), signal{ios} {}
+
+            /// Emplace an item on to the end of the buffer. If the buffer
+            /// is full then the first item is overwritten. One waiting
+            /// consumer is woken.
+            ///
+            /// Returns the number of free slots in the buffer
+            template<typename F>
+            std::size_t push_back(F fn) {
+                std::unique_lock<std::mutex> lock{exclusive};
+                auto const overwrite = items.full();
+                items.push_back(fn());
+                auto const free = items.capacity() - items.size();
+                lock.unlock();
+                if (not overwrite) signal.produced();
+                return free;
+            }
+            /// Emplace an item on to the back of the buffer. If the buffer
+            /// is full the predicate is run. It can return `true` to
+            /// indicate that the new item should be placed anyway.
+            ///
+            /// Returns the number of free slots in the buffer
+            template<typename F, typename P>
+            std::size_t push_back(F fn, P pred) {
+                std::unique_lock<std::mutex> lock{exclusive};
+                auto const overwrite = items.full();
+                if (overwrite && not pred(items.back())) { return 0; }
+                items.push_back(fn());
+                auto const free = items.capacity() - items.size();
+                lock.unlock();
+                if (not overwrite) signal.produced();
+                return free;
+            }
+
+            /// Pop the beginning of the buffer, suspending the coroutine
+            /// until there is an item available.
+            T pop_front(boost::asio::yield_context yield) {
+                signal.consume(yield);
+                std::lock_guard<std::mutex> lock{exclusive};
+                return pop_head();
+            }
+            /// Pop the beginning of the buffer and return the value that
+            /// was there. If the buffer is empty then return the value
+            /// passed in
+            template<
+                    typename D,
+                    typename = std::enable_if_t<not std::is_convertible_v<
+                            D, boost::asio::yield_context>>>
+            D pop_front(D d) {
+                if (signal.try_consume()) {
+                    std::lock_guard<std::mutex> lock{exclusive};
+                    return pop_head();
+                } else {
+                    return std::move(d);
+                }
+            }
+
+            /// Close the ring
             void close() { signal.close(); }
         };
 
@@ -0,0 +1,182 @@
+/**
+    Copyright 2026 Red Anchor Trading Co. Ltd.
+
+    Distributed under the Boost Software License, Version 1.0.
+    See <http://www.boost.org/LICENSE_1_0.txt>
+ */
+
+
+#pragma once
+
+
+#include <f5/threading/suspend.hpp>
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+
+namespace f5 {
+
+
+    namespace boost_asio {
+
+
+        /// Limits the rate of operations to `count` per `period`, allowing
+        /// bursts of up to `burst` operations. This is the generic cell
+        /// rate algorithm, which is equivalent to a token bucket but only
+        /// needs a single time stamp (the theoretical arrival time) as its
+        /// state.
+        ///
+        /// Acquiring tokens that are available is a single compare and
+        /// exchange. A coroutine that has to wait reserves its tokens
+        /// straight away, so later callers queue behind it, and is then
+        /// suspended. All waiting coroutines share a single timer which is
+        /// set for whichever of them is due first.
+        class rate_limiter {
+          public:
+            /// The clock used for timing
+            using clock_type = std::chrono::steady_clock;
+
+          private:
+            /// The time between tokens
+            const clock_type::duration interval;
+            /// How far ahead of the current time the theoretical arrival
+            /// time may be and still allow an operation
+            const clock_type::duration tolerance;
+            /// The theoretical arrival time, measured from the clock's
+            /// epoch
+            std::atomic<clock_type::rep> tat;
+
+            /// Mutex that controls access to the timer and waiters
+            std::mutex mutex;
+            /// The timer shared by all of the waiting coroutines
+            boost::asio::steady_timer timer;
+            /// The coroutines waiting for their tokens and when they are
+            /// due. Kept in time order
+            std::deque<std::pair<clock_type::time_point, resumer>> waiting;
+
+            /// Reserve `n` tokens and return the time at which they may be
+            /// used. If `now_only` is set then nothing is reserved unless
+            /// the tokens can be used immediately, in which case
+            /// `time_point::max()` is returned.
+            clock_type::time_point reserve(uint64_t n, bool now_only) {
+                auto const now = clock_type::now();
+                auto t = tat.load();
+                while (true) {
+                    auto const base =
+                            std::max(clock_type::time_point{
+                                             clock_type::duration{t}},
+                                     now);
+                    auto const next = base + interval * n;
+                    auto const due = next - tolerance;
+                    if (now_only && due > now) {
+                        return clock_type::time_point::max();
+                    }
+                    if (tat.compare_exchange_weak(
+                                t, next.time_since_epoch().count())) {
+                        return due;
+                    }
+                }
+            }
+            /// Set the timer for the first waiter. The lock must be held
+            void arm() {
+                timer.expires_at(waiting.front().first);
+                timer.async_wait([this](boost::system::error_code ec) {
+                    // The timer is cancelled when it is set again for an
+                    // earlier waiter, or when the limiter is destroyed
+                    if (not ec) expired();
+                });
+            }
+            /// The time between tokens for `count` operations in `period`.
+            /// An interval that rounds down to zero would not limit anything
+            static clock_type::duration
+                    interval_for(uint64_t count, clock_type::duration period) {
+                if (not count) {
+                    throw std::invalid_argument(
+                            "A rate_limiter must allow at least one "
+                            "operation in its period");
+                } else if (period < clock_type::duration(count)) {
+                    throw std::invalid_argument(
+                            "A rate_limiter period must be at least one "
+                            "clock tick for each operation");
+                }
+                return period / count;
+            }
+            /// Resume the waiters whose time has come and set the timer
+            /// for the next one
+            void expired() {
+                std::vector<resumer> due;
+                std::unique_lock<std::mutex> lock{mutex};
+                auto const now = clock_type::now();
+                while (waiting.size() && waiting.front().first <= now) {
+                    due.push_back(std::move(waiting.front().second));
+                    waiting.pop_front();
+                }
+                if (waiting.size()) arm();
+                lock.unlock();
+                for (auto &r : due) r();
+            }
+
+          public:
+            /// Allow `count` operations in each `period` with bursts of up
+            /// to `burst` operations. Throws `std::invalid_argument` if
+            /// `count` is zero or is more than the number of clock ticks in
+            /// `period`
+            rate_limiter(
+                    boost::asio::io_service &ios,
+                    uint64_t count,
+                    clock_type::duration period,
+                    uint64_t burst = 1)
+            : interval(interval_for(count, period)),
+              tolerance(interval * burst),
+              tat{},
+              timer(ios) {}
+
+            /// Make non-copyable and non assignable
+            rate_limiter(const rate_limiter &) = delete;
+            rate_limiter &operator=(const rate_limiter &) = delete;
+
+            /// Take `n` tokens if they are available now. Returns false,
+            /// and takes nothing, if they are not
+            bool try_acquire(uint64_t n = 1) {
+                return reserve(n, true) != clock_type::time_point::max();
+            }
+
+            /// Take `n` tokens, suspending the coroutine until they are
+            /// available. Callers are served in the order they arrive.
+            template<typename Y>
+            void acquire(uint64_t n, Y yield) {
+                auto const due = reserve(n, false);
+                if (due <= clock_type::now()) return;
+                suspend(yield, [this, due](resumer r) {
+                    std::unique_lock<std::mutex> lock{mutex};
+                    auto const pos = std::upper_bound(
+                            waiting.begin(), waiting.end(), due,
+                            [](auto const &d, auto const &w) {
+                                return d < w.first;
+                            });
+                    bool const first = pos == waiting.begin();
+                    waiting.emplace(pos, due, std::move(r));
+                    if (first) arm();
+                });
+            }
+            template<typename Y>
+            void acquire(Y yield) {
+                acquire(1, yield);
+            }
+        };
+
+
+    }
+
+
+}
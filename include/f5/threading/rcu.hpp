@@ -0,0 +1,402 @@
+/**
+    Copyright 2026 Red Anchor Trading Co. Ltd.
+
+    Distributed under the Boost Software License, Version 1.0.
+    See <http://www.boost.org/LICENSE_1_0.txt>
+ */
+
+
+#pragma once
+
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <f5/threading/policy.hpp>
+
+
+namespace f5 {
+
+
+    inline namespace threading {
+
+
+        /// Thread safe associative array (map) for data that is read far
+        /// more often than it is written. Readers never take a lock on the
+        /// map, instead they work on an immutable snapshot of the sorted
+        /// vector. Writers copy the current snapshot, change the copy and
+        /// then publish it. Old snapshots are freed when the last reader
+        /// that is using them is done.
+        ///
+        /// The published snapshot is reached through an atomic raw
+        /// pointer. A reader announces itself by incrementing one of a
+        /// set of striped counters, takes its own reference to the
+        /// snapshot and then leaves again, so readers only ever do lock
+        /// free atomic operations. A writer that replaces the pointer
+        /// waits for the readers that might still be looking at the old
+        /// one to leave before it frees it. The counters come in two
+        /// sets that new readers alternate between, so a steady stream
+        /// of readers can't hold a writer up.
+        ///
+        /// The values must be copyable. Any references returned to the
+        /// caller are only valid until the next change to the map.
+        template<
+                typename K,
+                typename V,
+                typename P = typename container_default_policy<V>::type>
+        class tsmap_rcu {
+          public:
+            /// The type of the data held in a snapshot
+            using vector_type = std::vector<std::pair<K, V>>;
+            /// A snapshot of the map. It will not change once published
+            using snapshot_type = std::shared_ptr<const vector_type>;
+
+          private:
+            /// The size of a cache line, used to keep the reader counters
+            /// apart
+            static constexpr std::size_t cache_line = 64;
+            /// The number of reader counters in each set
+            static constexpr std::size_t stripes = 16;
+            struct alignas(cache_line) counter {
+                std::atomic<std::size_t> readers{};
+            };
+            static_assert(
+                    std::atomic<std::size_t>::is_always_lock_free,
+                    "The reader counters must be lock free");
+
+            /// Mutex used to serialise the writers
+            std::mutex writer;
+            /// The currently published snapshot. Readers must only follow
+            /// it between `enter` and `leave`. Writers holding the
+            /// `writer` mutex may read through it directly
+            std::atomic<const snapshot_type *> current;
+            /// The set of counters that new readers use
+            std::atomic<std::size_t> epoch{};
+            /// The reader counters, one array for each epoch
+            mutable std::array<std::array<counter, stripes>, 2> readers;
+
+            /// Traits for controlling aspects of the implementation
+            using traits = P;
+
+            /// Return the lower bound for the key
+            template<typename M, typename L>
+            static auto lower_bound(M &map, const L &k) {
+                return std::lower_bound(
+                        map.begin(), map.end(), k,
+                        [](const auto &l, const auto &r) {
+                            return l.first < r;
+                        });
+            }
+
+            /// Return a copy of the snapshot with room for one more item
+            static std::unique_ptr<vector_type> copy(const vector_type &map) {
+                auto m = std::make_unique<vector_type>();
+                m->reserve(map.size() + 1);
+                m->assign(map.begin(), map.end());
+                return m;
+            }
+            /// The published snapshot. The writer lock must be held
+            const vector_type &latest() const { return **current.load(); }
+
+            /// The counter used by the calling thread
+            static std::size_t stripe() {
+                static std::atomic<std::size_t> threads{};
+                thread_local std::size_t const s = threads++ % stripes;
+                return s;
+            }
+            /// Wait until no reader is counted in the set
+            void wait_for_readers(std::size_t set) const {
+                for (auto &c : readers[set]) {
+                    while (c.readers.load()) std::this_thread::yield();
+                }
+            }
+            /// Publish the new snapshot and free the old one once no reader
+            /// can still be taking a reference to it. The writer lock must
+            /// be held.
+            ///
+            /// A reader that increments its counter after the writer has
+            /// seen that counter at zero must load the pointer after it was
+            /// replaced, so it is enough that each set is seen empty once.
+            /// The set not in use is drained first and then the sets are
+            /// swapped so that the other one can drain.
+            void publish(std::unique_ptr<vector_type> m) {
+                auto const fresh = new snapshot_type{std::move(m)};
+                std::unique_ptr<const snapshot_type> old{
+                        current.exchange(fresh)};
+                auto const e = epoch.load();
+                wait_for_readers(1 - e);
+                epoch.store(1 - e);
+                wait_for_readers(e);
+            }
+
+            /// True if values of the type can be compared for equality
+            template<typename T, typename = void>
+            struct is_comparable : std::false_type {};
+            template<typename T>
+            struct is_comparable<
+                    T,
+                    std::void_t<decltype(
+                            bool(std::declval<const T &>()
+                                 == std::declval<const T &>()))>>
+            : std::true_type {};
+            /// True if the lambda may have changed the value. Values that
+            /// can't be compared are assumed to have changed
+            static bool changed(const V &before, const V &after) {
+                if constexpr (is_comparable<V>::value) {
+                    return not(before == after);
+                } else {
+                    return true;
+                }
+            }
+            /// Copy the published snapshot, replace the value at the
+            /// position with the one given and publish the copy. Returns
+            /// the value in the new snapshot. The writer lock must be held
+            V &replace(std::size_t i, V v) {
+                auto map = copy(latest());
+                auto &r = (*map)[i].second = std::move(v);
+                publish(std::move(map));
+                return r;
+            }
+
+          public:
+            /// Construct an empty map
+            tsmap_rcu()
+            : current(new snapshot_type{
+                      std::make_shared<const vector_type>()}) {}
+            /// Free the published snapshot
+            ~tsmap_rcu() { delete current.load(); }
+
+            /// Make non-copyable and non assignable
+            tsmap_rcu(const tsmap_rcu &) = delete;
+            tsmap_rcu &operator=(const tsmap_rcu &) = delete;
+
+            /// Return the current snapshot of the map
+            snapshot_type snapshot() const {
+                auto &c = readers[epoch.load()][stripe()].readers;
+                c.fetch_add(1);
+                snapshot_type s = *current.load();
+                c.fetch_sub(1, std::memory_order_release);
+                return s;
+            }
+
+            /// Return an estimate of the size of the map.
+            std::size_t size() const { return snapshot()->size(); }
+
+            /// Return a pointer to the value if found. If not found then
+            /// return `nullptr`
+            template<typename L>
+            typename traits::found_type find(const L &k) const {
+                auto map = snapshot();
+                auto bound = lower_bound(*map, k);
+                if (bound == map->end() || k != bound->first) {
+                    return nullptr;
+                } else {
+                    return traits::found_from_V(bound->second);
+                }
+            }
+            /// Return either the item in the map, or the passed in default.
+            template<typename L>
+            typename traits::found_type
+                    find(const L &k, typename traits::found_type d) const {
+                if (auto p = find(k); p)
+                    return p;
+                else
+                    return d;
+            }
+            /// Run the lambda on a copy of the found item and publish the
+            /// result. Return true if the lambda was run. The snapshot is
+            /// only copied if the key is found and the value changes.
+            template<typename L, typename F>
+            bool alter(L const &k, F lambda) {
+                std::unique_lock<std::mutex> lock(writer);
+                auto const &map = latest();
+                auto found = lower_bound(map, k);
+                if (found == map.end() || k != found->first) {
+                    return false;
+                } else {
+                    V v = found->second;
+                    lambda(traits::reference_from_V(v));
+                    if (changed(found->second, v)) {
+                        replace(found - map.begin(), std::move(v));
+                    }
+                    return true;
+                }
+            }
+
+            /// Ensures the item at the requested key is the value given
+            template<typename A>
+            typename traits::value_return_type
+                    insert_or_assign(const K &k, A a) {
+                std::unique_lock<std::mutex> lock(writer);
+                auto map = copy(latest());
+                auto bound = lower_bound(*map, k);
+                if (bound != map->end() && bound->first == k) {
+                    bound->second = std::move(a);
+                } else {
+                    bound = map->emplace(
+                            bound, std::piecewise_construct,
+                            std::forward_as_tuple(k),
+                            std::forward_as_tuple(std::move(a)));
+                }
+                auto &v = bound->second;
+                publish(std::move(map));
+                return traits::value_from_V(v);
+            }
+            /// Adds the item if the key is not found. If the key is found and
+            /// the predicate returns true then replaces the value with the
+            /// one returned by the lambda
+            template<typename C, typename F>
+            typename traits::value_return_type
+                    insert_or_assign_if(const K &k, C predicate, F lambda) {
+                std::unique_lock<std::mutex> lock(writer);
+                auto const &latest = this->latest();
+                auto found = lower_bound(latest, k);
+                if (found != latest.end() && found->first == k
+                    && not predicate(found->second)) {
+                    // The snapshot doesn't need to change
+                    V v = found->second;
+                    return traits::value_from_V(v);
+                }
+                auto map = copy(latest);
+                auto bound = map->begin() + (found - latest.begin());
+                if (bound != map->end() && bound->first == k) {
+                    bound->second = lambda();
+                } else {
+                    bound = map->emplace(
+                            bound, std::piecewise_construct,
+                            std::forward_as_tuple(k),
+                            std::forward_as_tuple(lambda()));
+                }
+                auto &v = bound->second;
+                publish(std::move(map));
+                return traits::value_from_V(v);
+            }
+            /// Adds a value at the key if there isn't one there already.
+            /// Returns a reference to the item
+            template<typename... Args>
+            typename traits::value_return_type
+                    emplace_if_not_found(const K &k, Args &&... args) {
+                return add_if_not_found(k, [&]() {
+                    return V(std::forward<Args>(args)...);
+                });
+            }
+            /// Adds a value at the key if there isn't one there already.
+            /// Returns a reference to the newly constructed item. If
+            /// the item is already in the map then the second lambda is
+            /// executed on a copy of it, which is then published if it has
+            /// changed.
+            template<typename F, typename M>
+            typename traits::value_return_type
+                    add_if_not_found(const K &k, F lambda, M miss) {
+                std::unique_lock<std::mutex> lock(writer);
+                auto const &latest = this->latest();
+                auto found = lower_bound(latest, k);
+                auto const i = found - latest.begin();
+                if (found != latest.end() && found->first == k) {
+                    V v = found->second;
+                    miss(traits::reference_from_V(v));
+                    if (changed(found->second, v)) {
+                        return traits::value_from_V(replace(i, std::move(v)));
+                    } else {
+                        return traits::value_from_V(v);
+                    }
+                }
+                auto map = copy(latest);
+                auto &v = map->emplace(
+                                     map->begin() + i,
+                                     std::piecewise_construct,
+                                     std::forward_as_tuple(k),
+                                     std::forward_as_tuple(lambda()))
+                                  ->second;
+                publish(std::move(map));
+                return traits::value_from_V(v);
+            }
+            /// Adds a value at the key if there isn't one there already.
+            /// The snapshot is not copied if the key is already present.
+            template<typename F>
+            typename traits::value_return_type
+                    add_if_not_found(const K &k, F lambda) {
+                std::unique_lock<std::mutex> lock(writer);
+                auto const &latest = this->latest();
+                auto found = lower_bound(latest, k);
+                if (found != latest.end() && found->first == k) {
+                    V v = found->second;
+                    return traits::value_from_V(v);
+                }
+                auto map = copy(latest);
+                auto &v = map->emplace(
+                                     map->begin() + (found - latest.begin()),
+                                     std::piecewise_construct,
+                                     std::forward_as_tuple(k),
+                                     std::forward_as_tuple(lambda()))
+                                  ->second;
+                publish(std::move(map));
+                return traits::value_from_V(v);
+            }
+
+            /// Iterate over a snapshot of the content of the map. No lock
+            /// is held so the function may itself change the map, but those
+            /// changes won't be seen during this iteration.
+            template<typename F>
+            F for_each(F fn) const {
+                auto map = snapshot();
+                for (const auto &v : *map) fn(v.first, v.second);
+                return fn;
+            }
+
+            /// Remove the requested key (if found). Returns true if the
+            /// key and its value were removed
+            bool remove(const K &k) {
+                std::unique_lock<std::mutex> lock(writer);
+                auto const &latest = this->latest();
+                auto found = lower_bound(latest, k);
+                if (found == latest.end() || found->first != k) {
+                    return false;
+                } else {
+                    auto map = copy(latest);
+                    map->erase(map->begin() + (found - latest.begin()));
+                    publish(std::move(map));
+                    return true;
+                }
+            }
+
+            /// Removes values where the predicate is true. Returns how
+            /// many are left.
+            template<typename Pr>
+            std::size_t remove_if(Pr predicate) {
+                std::unique_lock<std::mutex> lock(writer);
+                auto const &latest = this->latest();
+                auto map = std::make_unique<vector_type>();
+                map->reserve(latest.size());
+                std::copy_if(
+                        latest.begin(), latest.end(),
+                        std::back_inserter(*map), [&](const auto &v) {
+                            return not predicate(v.first, v.second);
+                        });
+                const auto r = map->size();
+                publish(std::move(map));
+                return r;
+            }
+
+            /// Remove all entries for the map
+            std::size_t clear() {
+                std::unique_lock<std::mutex> lock(writer);
+                const auto r = latest().size();
+                publish(std::make_unique<vector_type>());
+                return r;
+            }
+        };
+
+
+    }
+
+
+}
@@ -1,5 +1,5 @@
 /**
-    Copyright 2015-2019 Red Anchor Trading Co. Ltd.
+    Copyright 2015-2026 Red Anchor Trading Co. Ltd.
 
     Distributed under the Boost Software License, Version 1.0.
     See <http://www.boost.org/LICENSE_1_0.txt>
@@ -11,7 +11,15 @@
 
 #include <boost/circular_buffer.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 
 namespace f5 {
@@ -65,9 +73,250 @@ namespace f5 {
                     return std::move(v);
                 }
             }
+
+            /// Emplace all of the items in the range on to the back of the
+            /// buffer under a single lock. If the buffer fills then the
+            /// first items are overwritten. The items are moved if the range
+            /// is an rvalue.
+            ///
+            /// Returns the number of free slots in the buffer
+            template<typename R>
+            std::size_t push_back_n(R &&range) {
+                std::unique_lock<std::mutex> lock(mutex);
+                for (auto &v : range) {
+                    if constexpr (std::is_rvalue_reference_v<R &&>) {
+                        ring.push_back(std::move(v));
+                    } else {
+                        ring.push_back(v);
+                    }
+                }
+                return ring.capacity() - ring.size();
+            }
+
+            /// Move up to `max` items from the beginning of the buffer to
+            /// the output iterator under a single lock. Returns the number
+            /// of items moved
+            template<typename O>
+            std::size_t pop_front_n(O out, std::size_t max) {
+                std::unique_lock<std::mutex> lock(mutex);
+                auto const n = std::min(max, ring.size());
+                std::move(ring.begin(), ring.begin() + n, out);
+                ring.erase_begin(n);
+                return n;
+            }
+            /// Empty the buffer, passing its content to the function without
+            /// copying it. The function is called with a `V *` begin and end
+            /// pair for each contiguous run of items, so at most twice, in
+            /// order. The lock is held while the function runs and the items
+            /// are only removed once it has returned for all of them.
+            ///
+            /// Returns the number of items removed
+            template<typename F>
+            std::size_t drain(F fn) {
+                std::unique_lock<std::mutex> lock(mutex);
+                auto const one = ring.array_one();
+                if (one.second) fn(one.first, one.first + one.second);
+                auto const two = ring.array_two();
+                if (two.second) fn(two.first, two.first + two.second);
+                auto const n = ring.size();
+                ring.clear();
+                return n;
+            }
+        };
+
+
+        /// Lock free circular buffer with a fixed number of slots. It has
+        /// the same interface as `tsring`, apart from `drain` and the
+        /// conditional `push_back`, and when full the oldest item is
+        /// overwritten. Each slot carries a sequence
+        /// number which tells producers and consumers whether it is free or
+        /// filled for their lap of the buffer.
+        ///
+        /// When the buffer is full a producer discards the oldest item by
+        /// consuming it, so the consumer side must always allow for more
+        /// than one consumer. `MultipleProducers` can be set to false when
+        /// only one thread ever pushes, which saves an atomic exchange for
+        /// each push.
+        template<typename V, bool MultipleProducers = true>
+        class tsring_lockfree {
+            /// The position of a slot within the buffer
+            using position = std::size_t;
+            struct slot {
+                std::atomic<position> sequence;
+                std::optional<V> value;
+            };
+            /// The size of a cache line, used to stop the producer and
+            /// consumer positions sharing one
+            static constexpr std::size_t cache_line = 64;
+
+            std::vector<slot> slots;
+            alignas(cache_line) std::atomic<position> back{};
+            alignas(cache_line) std::atomic<position> front{};
+
+            /// Try to put the item on the back of the buffer. The item is
+            /// moved from only if it is added. Returns false if the buffer
+            /// is full.
+            bool try_push(V &v) {
+                auto pos = back.load(std::memory_order_relaxed);
+                while (true) {
+                    auto &s = slots[pos % slots.size()];
+                    auto const seq = s.sequence.load(std::memory_order_acquire);
+                    auto const diff = std::intptr_t(seq) - std::intptr_t(pos);
+                    if (diff == 0) {
+                        if constexpr (MultipleProducers) {
+                            if (back.compare_exchange_weak(
+                                        pos, pos + 1,
+                                        std::memory_order_relaxed)) {
+                                break;
+                            }
+                        } else {
+                            back.store(pos + 1, std::memory_order_relaxed);
+                            break;
+                        }
+                    } else if (diff < 0) {
+                        return false;
+                    } else {
+                        pos = back.load(std::memory_order_relaxed);
+                    }
+                }
+                auto &s = slots[pos % slots.size()];
+                s.value.emplace(std::move(v));
+                s.sequence.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+            /// Try to take the item at the front of the buffer
+            std::optional<V> try_pop() {
+                auto pos = front.load(std::memory_order_relaxed);
+                while (true) {
+                    auto &s = slots[pos % slots.size()];
+                    auto const seq = s.sequence.load(std::memory_order_acquire);
+                    auto const diff =
+                            std::intptr_t(seq) - std::intptr_t(pos + 1);
+                    if (diff == 0) {
+                        if (front.compare_exchange_weak(
+                                    pos, pos + 1, std::memory_order_relaxed)) {
+                            break;
+                        }
+                    } else if (diff < 0) {
+                        return {};
+                    } else {
+                        pos = front.load(std::memory_order_relaxed);
+                    }
+                }
+                auto &s = slots[pos % slots.size()];
+                std::optional<V> v{std::move(s.value)};
+                s.value.reset();
+                s.sequence.store(
+                        pos + slots.size(), std::memory_order_release);
+                return v;
+            }
+            /// An estimate of the number of free slots
+            std::size_t available() const {
+                auto const f = front.load(std::memory_order_relaxed);
+                auto const b = back.load(std::memory_order_relaxed);
+                auto const used = b > f ? b - f : 0;
+                return used < slots.size() ? slots.size() - used : 0;
+            }
+
+          public:
+            /// Construct a ring with the specified number of slots
+            /// available. There must be at least two, as with one slot the
+            /// sequence number of a full slot is the same as that of the
+            /// slot empty for the next lap
+            tsring_lockfree(std::size_t s) : slots(s) {
+                if (s < 2) {
+                    throw std::invalid_argument(
+                            "A tsring_lockfree needs at least two slots");
+                }
+                for (std::size_t i{}; i < s; ++i) {
+                    slots[i].sequence.store(i, std::memory_order_relaxed);
+                }
+            }
+
+            /// Emplace an item on to the end of the buffer. If the buffer is
+            /// full then the first item is overwritten.
+            ///
+            /// Returns an estimate of the number of free slots in the buffer
+            template<typename F>
+            std::size_t push_back(F fn) {
+                V v = fn();
+                while (not try_push(v)) try_pop();
+                return available();
+            }
+            /// Emplace an item on to the back of the buffer. If the buffer is
+            /// full the predicate is passed the new item and can return
+            /// `true` to have the oldest item overwritten, otherwise the new
+            /// item is discarded.
+            ///
+            /// This takes the place of the conditional `tsring::push_back`,
+            /// but with a different name because it behaves differently: the
+            /// newest item in the buffer can't be safely looked at, so the
+            /// predicate sees the new one instead, and `fn` is always called
+            /// because the item has to exist before the push is attempted.
+            ///
+            /// Returns an estimate of the number of free slots in the buffer
+            template<typename F, typename P>
+            std::size_t push_back_or_discard(F fn, P pred) {
+                V v = fn();
+                if (not try_push(v) && pred(std::as_const(v))) {
+                    do { try_pop(); } while (not try_push(v));
+                }
+                return available();
+            }
+
+            /// Pop the beginning of the buffer and return the value that was
+            /// there. If the buffer is empty then return the value passed in
+            template<typename D>
+            D pop_front(D d) {
+                if (auto v = try_pop(); v) {
+                    return std::move(*v);
+                } else {
+                    return std::move(d);
+                }
+            }
+
+            /// Emplace all of the items in the range on to the back of the
+            /// buffer. Each item is pushed separately, so items from other
+            /// producers may be interleaved with them.
+            ///
+            /// Returns an estimate of the number of free slots in the buffer
+            template<typename R>
+            std::size_t push_back_n(R &&range) {
+                for (auto &v : range) {
+                    if constexpr (std::is_rvalue_reference_v<R &&>) {
+                        push_back([&v]() { return std::move(v); });
+                    } else {
+                        push_back([&v]() { return v; });
+                    }
+                }
+                return available();
+            }
+
+            /// Move up to `max` items from the beginning of the buffer to
+            /// the output iterator. Returns the number of items moved
+            template<typename O>
+            std::size_t pop_front_n(O out, std::size_t max) {
+                std::size_t n{};
+                for (; n < max; ++n) {
+                    auto v = try_pop();
+                    if (not v) break;
+                    *out++ = std::move(*v);
+                }
+                return n;
+            }
         };
 
 
+        /// A lock free ring for a single producer thread and a single
+        /// consumer thread. The producer consumes when it overwrites, so
+        /// only the producer side is relaxed
+        template<typename V>
+        using tsring_spsc = tsring_lockfree<V, false>;
+        /// A lock free ring for many producer and consumer threads
+        template<typename V>
+        using tsring_mpmc = tsring_lockfree<V, true>;
+
+
     }
 
 
@@ -0,0 +1,129 @@
+/**
+    Copyright 2026 Red Anchor Trading Co. Ltd.
+
+    Distributed under the Boost Software License, Version 1.0.
+    See <http://www.boost.org/LICENSE_1_0.txt>
+ */
+
+
+#pragma once
+
+
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+
+
+namespace f5 {
+
+
+    inline namespace threading {
+
+
+        /// Return the index of the first item in the sorted array that is
+        /// not less than the key. The loop has no data dependent branches,
+        /// so it doesn't suffer from branch mispredictions, and the next
+        /// two possible probes are prefetched. Best suited to small key
+        /// types where many keys share a cache line.
+        template<typename T, typename L>
+        std::size_t branchless_lower_bound(
+                const T *base, std::size_t n, const L &k) {
+            if (not n) return 0;
+            const T *first = base;
+            while (n > 1) {
+                auto const half = n / 2;
+#if defined(__GNUC__)
+                __builtin_prefetch(first + half / 2);
+                __builtin_prefetch(first + half + half / 2);
+#endif
+                first = (first[half] < k) ? first + half : first;
+                n -= half;
+            }
+            return (first - base) + (*first < k);
+        }
+
+
+        /// True for the key types that can be searched without branching.
+        /// `bool` is excluded because `std::vector<bool>` has no `data()`
+        template<typename K>
+        constexpr bool is_branchless_key_v =
+                std::is_arithmetic_v<K> and not std::is_same_v<K, bool>;
+
+
+        /// Index of the keys of a sorted vector of key/value pairs. The
+        /// general case just searches the pairs themselves.
+        template<typename K, bool = is_branchless_key_v<K>>
+        class key_index {
+          public:
+            /// Return the index of the lower bound of the key. Only the
+            /// items from index `from` on are searched
+            template<typename V, typename L>
+            std::size_t lower_bound(
+                    const std::vector<std::pair<K, V>> &v,
+                    const L &k,
+                    std::size_t from = 0) const {
+                return std::lower_bound(
+                               v.begin() + from, v.end(), k,
+                               [](const auto &l, const auto &r) {
+                                   return l.first < r;
+                               })
+                        - v.begin();
+            }
+
+            /// Make sure the index can hold `n` keys without allocating
+            void reserve(std::size_t) {}
+            /// Record the key inserted at the index
+            void insert(std::size_t, const K &) {}
+            /// Record the removal of the key at the index
+            void erase(std::size_t) {}
+            /// Rebuild the index from the vector
+            template<typename V>
+            void rebuild(const std::vector<std::pair<K, V>> &) {}
+            /// Empty the index
+            void clear() {}
+        };
+
+
+        /// Arithmetic keys are copied into their own contiguous array. A
+        /// search then only touches the keys, and not the values stored
+        /// between them, so many more keys fit in each cache line.
+        template<typename K>
+        class key_index<K, true> {
+            std::vector<K> keys;
+
+          public:
+            template<typename V, typename L>
+            std::size_t lower_bound(
+                    const std::vector<std::pair<K, V>> &,
+                    const L &k,
+                    std::size_t from = 0) const {
+                return from
+                        + branchless_lower_bound(
+                                keys.data() + from, keys.size() - from, k);
+            }
+
+            /// Grows geometrically so that reserving for each insert stays
+            /// cheap. Once reserved, `insert` and `rebuild` can't throw
+            void reserve(std::size_t n) {
+                if (keys.capacity() < n) {
+                    keys.reserve(std::max(n, 2 * keys.capacity()));
+                }
+            }
+            void insert(std::size_t i, const K &k) {
+                keys.insert(keys.begin() + i, k);
+            }
+            void erase(std::size_t i) { keys.erase(keys.begin() + i); }
+            template<typename V>
+            void rebuild(const std::vector<std::pair<K, V>> &v) {
+                keys.clear();
+                keys.reserve(v.size());
+                for (const auto &p : v) keys.push_back(p.first);
+            }
+            void clear() { keys.clear(); }
+        };
+
+
+    }
+
+
+}
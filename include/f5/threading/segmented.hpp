@@ -0,0 +1,120 @@
+/**
+    Copyright 2026 Red Anchor Trading Co. Ltd.
+
+    Distributed under the Boost Software License, Version 1.0.
+    See <http://www.boost.org/LICENSE_1_0.txt>
+ */
+
+
+#pragma once
+
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+
+namespace f5 {
+
+
+    inline namespace threading {
+
+
+        /// Thread safe unbounded FIFO store made from a linked list of
+        /// fixed size segments. Producers only ever take the tail lock and
+        /// consumers only ever take the head lock, so producers and
+        /// consumers don't contend with each other. Each segment holds `N`
+        /// items so there is no allocation per item, and the most recently
+        /// emptied segment is kept for reuse.
+        ///
+        /// It can be used as the store for `boost_asio::queue`, which then
+        /// uses no lock of its own.
+        template<typename T, std::size_t N = 256>
+        class segmented_store {
+            struct segment {
+                std::array<std::optional<T>, N> items;
+                /// The number of items written into the segment. Only
+                /// changed with the tail lock held
+                std::atomic<std::size_t> written{};
+                /// The number of items read from the segment. Only used
+                /// with the head lock held
+                std::size_t read{};
+                /// The next segment, set with the tail lock held
+                std::atomic<segment *> next{};
+            };
+
+            /// Lock held by producers
+            std::mutex tail_mutex;
+            /// The segment being written to
+            segment *tail;
+            /// Lock held by consumers
+            std::mutex head_mutex;
+            /// The segment being read from
+            segment *head;
+            /// An emptied segment kept for reuse
+            std::atomic<segment *> spare{};
+
+          public:
+            /// The type of item stored
+            using value_type = T;
+            /// Tells `boost_asio::queue` that it needs no lock for the store
+            static constexpr bool concurrent = true;
+
+            segmented_store() : tail(new segment), head(tail) {}
+            ~segmented_store() {
+                while (head) delete std::exchange(head, head->next.load());
+                delete spare.load();
+            }
+
+            /// Make non-copyable and non assignable
+            segmented_store(const segmented_store &) = delete;
+            segmented_store &operator=(const segmented_store &) = delete;
+
+            /// Add an item at the back
+            void push_back(T t) {
+                std::lock_guard<std::mutex> lock{tail_mutex};
+                auto const pos = tail->written.load(std::memory_order_relaxed);
+                if (pos == N) {
+                    auto s = spare.exchange(nullptr);
+                    if (not s) s = new segment;
+                    s->items[0].emplace(std::move(t));
+                    s->written.store(1, std::memory_order_relaxed);
+                    tail->next.store(s, std::memory_order_release);
+                    tail = s;
+                } else {
+                    tail->items[pos].emplace(std::move(t));
+                    tail->written.store(pos + 1, std::memory_order_release);
+                }
+            }
+
+            /// Remove the item at the front, if there is one
+            std::optional<T> try_pop_front() {
+                std::lock_guard<std::mutex> lock{head_mutex};
+                if (head->read == N) {
+                    auto next = head->next.load(std::memory_order_acquire);
+                    if (not next) return {};
+                    // The producers have moved on from the old head so
+                    // it can be reset and kept for reuse
+                    auto old = std::exchange(head, next);
+                    old->written.store(0, std::memory_order_relaxed);
+                    old->read = 0;
+                    old->next.store(nullptr, std::memory_order_relaxed);
+                    delete spare.exchange(old);
+                }
+                auto const available =
+                        head->written.load(std::memory_order_acquire);
+                if (head->read == available) return {};
+                auto &item = head->items[head->read++];
+                std::optional<T> v{std::move(*item)};
+                item.reset();
+                return v;
+            }
+        };
+
+
+    }
+
+
+}
@@ -0,0 +1,200 @@
+/**
+    Copyright 2026 Red Anchor Trading Co. Ltd.
+
+    Distributed under the Boost Software License, Version 1.0.
+    See <http://www.boost.org/LICENSE_1_0.txt>
+ */
+
+
+#pragma once
+
+
+#include <f5/threading/suspend.hpp>
+
+#include <boost/asio/error.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+
+namespace f5 {
+
+
+    namespace boost_asio {
+
+
+        /// Consumes from whichever of several sources, such as `queue` and
+        /// `channel`, has an item, without needing a coroutine for each
+        /// source. A source must provide a non-blocking `consume` that
+        /// returns an optional value, `empty`, `closed`, `get_io_service`,
+        /// and `watch` and `unwatch`, which register a `resumer` to be
+        /// called the next time the source has an item produced or is
+        /// closed.
+        ///
+        /// Once every source has been closed and emptied consuming throws
+        /// an `operation_aborted` error, as consuming from a single closed
+        /// `queue` or `channel` does.
+        ///
+        /// The sources are tried in turn, starting from a different one each
+        /// time, so a busy source can't starve the others. Each selector
+        /// also starts from a different source to the one made before it.
+        template<typename... S>
+        class selector {
+            static_assert(sizeof...(S) > 0, "There must be a source");
+
+          public:
+            /// The type of value returned from the sources
+            using value_type = std::common_type_t<typename S::value_type...>;
+            /// The index of the source and the value consumed from it
+            using result_type = std::pair<std::size_t, value_type>;
+
+          private:
+            using indexes = std::index_sequence_for<S...>;
+
+            /// The sources
+            std::tuple<S &...> sources;
+            /// Where the next attempt starts
+            std::size_t next;
+            /// Used to give each selector a different starting point
+            inline static std::atomic<std::size_t> selectors{};
+
+            /// Try to consume from source `I`
+            template<std::size_t I>
+            void try_source(std::optional<result_type> &got) {
+                if (auto v = std::get<I>(sources).consume()) {
+                    got.emplace(I, std::move(*v));
+                }
+            }
+            template<std::size_t... I>
+            std::optional<result_type>
+                    try_source(std::size_t i, std::index_sequence<I...>) {
+                std::optional<result_type> got;
+                ((I == i ? try_source<I>(got) : void()), ...);
+                return got;
+            }
+            /// Try each source in turn, once
+            std::optional<result_type> try_all() {
+                auto const first = next++;
+                for (std::size_t n{}; n < sizeof...(S); ++n) {
+                    auto const i = (first + n) % sizeof...(S);
+                    if (auto got = try_source(i, indexes{})) return got;
+                }
+                return {};
+            }
+            /// True if any of the sources has something to consume
+            bool any_ready() const {
+                return std::apply(
+                        [](auto &... s) { return (not s.empty() || ...); },
+                        sources);
+            }
+            /// True if every source has been closed and has nothing left
+            bool all_closed() const {
+                return std::apply(
+                        [](auto &... s) {
+                            return ((s.closed() && s.empty()) && ...);
+                        },
+                        sources);
+            }
+            /// Throw if there is nothing more to consume from any source
+            void check_closed() const {
+                if (all_closed()) {
+                    throw boost::system::system_error(
+                            boost::asio::error::operation_aborted);
+                }
+            }
+            void watch(const resumer &r) {
+                std::apply([&r](auto &... s) { (s.watch(r), ...); }, sources);
+            }
+            void unwatch(const resumer &r) {
+                std::apply([&r](auto &... s) { (s.unwatch(r), ...); }, sources);
+            }
+            /// Suspend until a source might have an item. The function
+            /// is passed the resumer so that it can register it elsewhere
+            template<typename Y, typename F>
+            void wait(Y yield, F also) {
+                std::optional<resumer> watching;
+                try {
+                    suspend(yield, [&](resumer r) {
+                        watching = r;
+                        watch(r);
+                        also(r);
+                        // Something may have arrived, or the sources been
+                        // closed, before we started watching
+                        if (any_ready() || all_closed()) r();
+                    });
+                } catch (...) {
+                    if (watching) unwatch(*watching);
+                    throw;
+                }
+                unwatch(*watching);
+            }
+
+          public:
+            /// Construct from the sources to consume from
+            explicit selector(S &... s)
+            : sources(s...), next(selectors++ % sizeof...(S)) {}
+
+            /// Consume an item from whichever source has one, yielding until
+            /// one does. Throws once all of the sources are closed and empty
+            template<typename Y>
+            result_type consume(Y yield) {
+                while (true) {
+                    if (auto got = try_all()) return std::move(*got);
+                    check_closed();
+                    wait(yield, [](auto const &) {});
+                }
+            }
+            /// Consume an item from whichever source has one, yielding for
+            /// no longer than `timeout`. Returns an empty optional if the
+            /// time runs out
+            template<typename Y, typename Rep, typename Period>
+            std::optional<result_type> consume(
+                    Y yield, std::chrono::duration<Rep, Period> timeout) {
+                auto const deadline = std::chrono::steady_clock::now()
+                        + std::chrono::duration_cast<
+                                std::chrono::steady_clock::duration>(timeout);
+                boost::asio::steady_timer timer{
+                        std::get<0>(sources).get_io_service()};
+                while (true) {
+                    if (auto got = try_all()) return got;
+                    check_closed();
+                    if (std::chrono::steady_clock::now() >= deadline) {
+                        return {};
+                    }
+                    timer.expires_at(deadline);
+                    wait(yield, [&timer](resumer r) {
+                        timer.async_wait([r](auto) { r(); });
+                    });
+                    timer.cancel();
+                }
+            }
+        };
+
+
+        /// Consume an item from whichever of the sources has one, yielding
+        /// until one does. Returns the index of the source and the value
+        template<typename Y, typename... S>
+        auto consume_any(Y yield, S &... sources) {
+            return selector<S...>{sources...}.consume(yield);
+        }
+        /// Consume an item from whichever of the sources has one, yielding
+        /// for no longer than `timeout`. Returns an empty optional if no
+        /// item arrived in time
+        template<typename Y, typename Rep, typename Period, typename... S>
+        auto consume_any(
+                Y yield,
+                std::chrono::duration<Rep, Period> timeout,
+                S &... sources) {
+            return selector<S...>{sources...}.consume(yield, timeout);
+        }
+
+
+    }
+
+
+}
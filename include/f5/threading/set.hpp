@@ -1,5 +1,5 @@
 /**
-    Copyright 2015-2019 Red Anchor Trading Co. Ltd.
+    Copyright 2015-2026 Red Anchor Trading Co. Ltd.
 
     Distributed under the Boost Software License, Version 1.0.
     See <http://www.boost.org/LICENSE_1_0.txt>
@@ -10,10 +10,14 @@
 
 
 #include <algorithm>
+#include <functional>
 #include <mutex>
+#include <optional>
+#include <shared_mutex>
 #include <vector>
 
 #include <f5/threading/policy.hpp>
+#include <f5/threading/search.hpp>
 
 
 namespace f5 {
@@ -25,39 +29,53 @@ namespace f5 {
         /// Thread safe set implemented on a std::vector
         template<
                 typename V,
-                typename P = typename container_default_policy<V>::type>
+                typename P = typename container_default_policy<V>::type,
+                typename Mutex = std::mutex>
         class tsset {
             /// Mutex used to control access to the vector
-            mutable std::mutex mutex;
+            mutable Mutex mutex;
             /// Vector which stores the data
             std::vector<V> set;
 
             /// Traits for controlling aspects of the implementation
             using traits = P;
+            /// The lock used by members that only read the data
+            using read_lock = typename container_read_lock<Mutex>::type;
 
-            /// Return the lower bound for the key
+            /// Return the lower bound for the key. Arithmetic values are
+            /// searched without branching on the comparisons
             auto lower_bound(const V &k) const {
-                return std::lower_bound(
-                        set.begin(), set.end(), k,
-                        [](const auto &l, auto r) { return l < r; });
+                if constexpr (is_branchless_key_v<V>) {
+                    return set.begin()
+                            + branchless_lower_bound(set.data(), set.size(), k);
+                } else {
+                    return std::lower_bound(
+                            set.begin(), set.end(), k,
+                            [](const auto &l, auto r) { return l < r; });
+                }
             }
             auto lower_bound(const V &k) {
-                return std::lower_bound(
-                        set.begin(), set.end(), k,
-                        [](const auto &l, auto r) { return l < r; });
+                if constexpr (is_branchless_key_v<V>) {
+                    return set.begin()
+                            + branchless_lower_bound(set.data(), set.size(), k);
+                } else {
+                    return std::lower_bound(
+                            set.begin(), set.end(), k,
+                            [](const auto &l, auto r) { return l < r; });
+                }
             }
 
           public:
             /// Return an estimate of the size of the set.
             std::size_t size() {
-                std::unique_lock<std::mutex> lock(mutex);
+                read_lock lock(mutex);
                 return set.size();
             }
 
             /// Insert the item if not found. Returns true if the item was
             /// inserted.
             bool insert_if_not_found(const V &v) {
-                std::unique_lock<std::mutex> lock(mutex);
+                std::unique_lock<Mutex> lock(mutex);
                 auto bound = lower_bound(v);
                 if (bound == set.end() || not(*bound == v)) {
                     set.insert(bound, v);
@@ -69,14 +87,51 @@ namespace f5 {
             /// Iterate over the content of the set
             template<typename F>
             F for_each(F fn) const {
-                std::unique_lock<std::mutex> lock(mutex);
+                read_lock lock(mutex);
                 return std::move(std::for_each(set.begin(), set.end(), fn));
             }
+            /// Iterate over the content of the set without holding the lock
+            /// for the whole walk. The lock is held while at most `chunk`
+            /// items are passed to the function and then released so that
+            /// writers can make progress. Items are visited in order and
+            /// each at most once, but items added or removed during the
+            /// walk may or may not be seen. The function must not use the
+            /// set.
+            template<typename F>
+            F for_each_chunked(F fn, std::size_t chunk = 64) const {
+                chunk = std::max<std::size_t>(chunk, 1);
+                std::optional<V> last;
+                while (true) {
+                    read_lock lock(mutex);
+                    auto pos = set.begin();
+                    if (last) {
+                        pos = lower_bound(*last);
+                        if (pos != set.end() && not(*last < *pos)) ++pos;
+                    }
+                    if (pos == set.end()) return fn;
+                    auto const end = std::size_t(set.end() - pos) > chunk
+                            ? pos + chunk
+                            : set.end();
+                    std::for_each(pos, end, std::ref(fn));
+                    last = *std::prev(end);
+                }
+            }
+            /// Iterate over the items that are not less than `lo` and are
+            /// less than `hi`, in order
+            template<typename F>
+            F for_each_range(const V &lo, const V &hi, F fn) const {
+                read_lock lock(mutex);
+                for (auto pos = lower_bound(lo); pos != set.end() && *pos < hi;
+                     ++pos) {
+                    fn(*pos);
+                }
+                return fn;
+            }
 
             /// Remove the last item from the set and return it. If the set
             /// is empty then return the argument passed.
             typename traits::found_type pop_back(const V &s = V()) {
-                std::unique_lock<std::mutex> lock(mutex);
+                std::unique_lock<Mutex> lock(mutex);
                 if (set.empty()) {
                     return traits::found_from_V(s);
                 } else {
@@ -90,9 +145,9 @@ namespace f5 {
             /// Remove the value from the set. Returns true if the
             /// value was removed, false otherwise
             bool remove(const V &s) {
-                std::unique_lock<std::mutex> lock(mutex);
+                std::unique_lock<Mutex> lock(mutex);
                 auto item = lower_bound(s);
-                if (item == set.end())
+                if (item == set.end() || not(*item == s))
                     return false;
                 else {
                     set.erase(item);
@@ -103,7 +158,7 @@ namespace f5 {
             /// Remove the items that match the predicate
             template<typename F>
             std::size_t remove_if(F fn) {
-                std::unique_lock<std::mutex> lock(mutex);
+                std::unique_lock<Mutex> lock(mutex);
                 set.erase(
                         std::remove_if(set.begin(), set.end(), fn), set.end());
                 return set.size();
@@ -111,6 +166,14 @@ namespace f5 {
         };
 
 
+        /// A `tsset` where iteration shares the lock and only the members
+        /// that change the set take it exclusively
+        template<
+                typename V,
+                typename P = typename container_default_policy<V>::type>
+        using tsset_rw = tsset<V, P, std::shared_mutex>;
+
+
     }
 
 
@@ -0,0 +1,157 @@
+/**
+    Copyright 2026 Red Anchor Trading Co. Ltd.
+
+    Distributed under the Boost Software License, Version 1.0.
+    See <http://www.boost.org/LICENSE_1_0.txt>
+ */
+
+
+#pragma once
+
+
+#include <f5/threading/suspend.hpp>
+
+#include <boost/asio/error.hpp>
+#include <boost/asio/io_service.hpp>
+
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+
+namespace f5 {
+
+
+    namespace boost_asio {
+
+
+        /// A capacity limited channel for multiple producers and consumers
+        /// built directly on a fixed array of slots. It behaves like
+        /// `channel`, but a single mutex covers the slots and the
+        /// suspended coroutines, so there is one wait and notify mechanism
+        /// rather than a limiter and a queue each with their own. Producers
+        /// are suspended while every slot is full and consumers while every
+        /// slot is empty.
+        ///
+        /// The slots are allocated up front and suspended coroutines are
+        /// kept in a `wait_list`, so the channel itself never allocates.
+        /// Resuming a suspended coroutine posts its handler through Asio
+        /// though, and Asio may allocate for that.
+        template<typename V>
+        class slot_channel {
+            /// The IO service
+            boost::asio::io_service &service;
+            /// Mutex that controls access to everything below
+            std::mutex mutex;
+            /// The slots, used as a ring
+            std::vector<std::optional<V>> slots;
+            /// The slot holding the oldest item
+            std::size_t head = {};
+            /// The number of slots holding an item
+            std::size_t count = {};
+            /// Coroutines waiting for a free slot, an item, and for the
+            /// channel to empty
+            wait_list producers, consumers, draining;
+            /// Set once the channel has been closed
+            bool closed = false;
+
+            /// Throw if the channel has been closed. The lock must be held
+            void check_open() const {
+                if (closed) {
+                    throw boost::system::system_error(
+                            boost::asio::error::operation_aborted);
+                }
+            }
+
+          public:
+            /// Construct a new channel with the specified capacity
+            slot_channel(boost::asio::io_service &ios, std::size_t capacity)
+            : service(ios), slots(capacity) {
+                if (not capacity) {
+                    throw std::invalid_argument(
+                            "A slot_channel needs at least one slot");
+                }
+            }
+
+            /// Make non-copyable and non assignable
+            slot_channel(const slot_channel &) = delete;
+            slot_channel &operator=(const slot_channel &) = delete;
+
+            /// Return the IO service
+            boost::asio::io_service &get_io_service() { return service; }
+            /// Return the capacity of the channel
+            std::size_t size() const { return slots.size(); }
+
+            /// Add a new item to the channel. The coroutine yields until
+            /// there is a free slot. Throws if the channel is closed
+            template<typename Y>
+            void produce(V v, Y yield) {
+                std::unique_lock<std::mutex> lock{mutex};
+                check_open();
+                while (count == slots.size()) {
+                    producers.wait(lock, yield);
+                    check_open();
+                }
+                slots[(head + count) % slots.size()].emplace(std::move(v));
+                ++count;
+                auto consumer = consumers.pop_front();
+                lock.unlock();
+                if (consumer) consumer->resume();
+            }
+
+            /// Yield until a value is available to consume. Values already
+            /// in the channel can still be consumed once it has been closed,
+            /// after which this throws
+            template<typename Y>
+            V consume(Y yield) {
+                std::unique_lock<std::mutex> lock{mutex};
+                while (not count) {
+                    check_open();
+                    consumers.wait(lock, yield);
+                }
+                auto &slot = slots[head];
+                V v{std::move(*slot)};
+                slot.reset();
+                head = (head + 1) % slots.size();
+                --count;
+                auto producer = producers.pop_front();
+                auto drained = count ? wait_list{} : std::move(draining);
+                lock.unlock();
+                if (producer) producer->resume();
+                drained.resume_all();
+                return v;
+            }
+
+            /// Yield until all of the work that has been produced has been
+            /// consumed.
+            template<typename Y>
+            void wait_for_all_outstanding(Y yield) {
+                std::unique_lock<std::mutex> lock{mutex};
+                while (count) {
+                    check_open();
+                    draining.wait(lock, yield);
+                }
+            }
+
+            /// Close the channel. Suspended coroutines, and any that try
+            /// to produce later, get an `operation_aborted` error
+            void close() {
+                std::unique_lock<std::mutex> lock{mutex};
+                closed = true;
+                auto p = std::move(producers);
+                auto c = std::move(consumers);
+                auto d = std::move(draining);
+                lock.unlock();
+                p.resume_all(boost::asio::error::operation_aborted);
+                c.resume_all(boost::asio::error::operation_aborted);
+                d.resume_all(boost::asio::error::operation_aborted);
+            }
+        };
+
+
+    }
+
+
+}
@@ -0,0 +1,211 @@
+/**
+    Copyright 2026 Red Anchor Trading Co. Ltd.
+
+    Distributed under the Boost Software License, Version 1.0.
+    See <http://www.boost.org/LICENSE_1_0.txt>
+ */
+
+
+#pragma once
+
+
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/spawn.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+
+namespace f5 {
+
+
+    namespace boost_asio {
+
+
+        /// Resumes a coroutine that has been suspended by `suspend`. It
+        /// may be called from any thread. Copies share the coroutine, and
+        /// only the first call on any of them has any effect. This allows
+        /// the same coroutine to be registered in several places (for
+        /// example against a timer as well as a queue) with the first to
+        /// fire winning.
+        class resumer {
+            struct state {
+                std::atomic<bool> resumed{false};
+                std::function<void(boost::system::error_code)> resume;
+            };
+            std::shared_ptr<state> s;
+
+            template<typename Y, typename F>
+            friend void suspend(Y, F);
+
+            template<typename H>
+            explicit resumer(H h) : s(std::make_shared<state>()) {
+                s->resume = [h](boost::system::error_code ec) mutable {
+                    auto ex = boost::asio::get_associated_executor(h);
+                    boost::asio::post(ex, [h, ec]() mutable { h(ec); });
+                };
+            }
+
+          public:
+            /// Resume the coroutine. The error code, if set, is thrown
+            /// from `suspend` (or reported through the yield context's
+            /// error code). Returns true if this call resumed the coroutine
+            /// and false if it had already been resumed.
+            bool operator()(boost::system::error_code ec = {}) const {
+                if (s->resumed.exchange(true)) return false;
+                auto fn = std::move(s->resume);
+                fn(ec);
+                return true;
+            }
+
+            /// Returns true if the coroutine has already been resumed
+            bool resumed() const { return s->resumed.load(); }
+
+            /// Copies of a resumer compare equal
+            bool operator==(const resumer &r) const { return s == r.s; }
+            bool operator!=(const resumer &r) const { return s != r.s; }
+        };
+
+
+        /// Suspend the coroutine until it is resumed. The function is
+        /// passed a `resumer` which it needs to store somewhere where
+        /// another thread will find it. It is safe for the coroutine to be
+        /// resumed before `suspend` has actually suspended it.
+        template<typename Y, typename F>
+        void suspend(Y yield, F reg) {
+            boost::asio::async_completion<Y, void(boost::system::error_code)>
+                    init(yield);
+            reg(resumer{init.completion_handler});
+            return init.result.get();
+        }
+
+
+        /// A FIFO list of suspended coroutines that doesn't allocate. The
+        /// entry for each coroutine lives on the coroutine's own stack for
+        /// as long as it is suspended. The list isn't thread safe, and is
+        /// meant to be guarded by the owner's mutex. Resuming an entry
+        /// posts the coroutine's handler to its executor, which is left to
+        /// Asio's handler allocation.
+        class wait_list {
+          public:
+            /// A suspended coroutine
+            class entry {
+                friend class wait_list;
+                entry *next = nullptr;
+                bool queued = false;
+
+              protected:
+                ~entry() = default;
+
+              public:
+                /// Resume the coroutine. The entry must already have been
+                /// removed from its list and must not be used afterwards
+                virtual void resume(boost::system::error_code ec = {}) = 0;
+            };
+
+          private:
+            entry *head = nullptr, *tail = nullptr;
+            std::size_t m_size = {};
+
+            /// The entry for a coroutine with completion handler `H`
+            template<typename H>
+            struct parked final : public entry {
+                H handler;
+                parked(H h) : handler(std::move(h)) {}
+                void resume(boost::system::error_code ec) override {
+                    auto h = std::move(handler);
+                    auto ex = boost::asio::get_associated_executor(h);
+                    boost::asio::post(
+                            ex, [h = std::move(h), ec]() mutable { h(ec); });
+                }
+            };
+
+          public:
+            wait_list() = default;
+            wait_list(wait_list &&w)
+            : head(std::exchange(w.head, nullptr)),
+              tail(std::exchange(w.tail, nullptr)),
+              m_size(std::exchange(w.m_size, 0)) {}
+            wait_list(const wait_list &) = delete;
+            wait_list &operator=(const wait_list &) = delete;
+
+            /// True if nothing is waiting
+            bool empty() const { return not head; }
+            /// The number waiting
+            std::size_t size() const { return m_size; }
+
+            /// Add an entry at the back
+            void push_back(entry &e) {
+                e.next = nullptr;
+                e.queued = true;
+                if (tail) {
+                    tail->next = &e;
+                } else {
+                    head = &e;
+                }
+                tail = &e;
+                ++m_size;
+            }
+            /// Remove and return the entry at the front, or `nullptr` if
+            /// the list is empty
+            entry *pop_front() {
+                auto e = head;
+                if (e) {
+                    head = std::exchange(e->next, nullptr);
+                    if (not head) tail = nullptr;
+                    e->queued = false;
+                    --m_size;
+                }
+                return e;
+            }
+            /// Remove the entry if it is still in the list
+            void remove(entry &e) {
+                if (not e.queued) return;
+                entry *prior = nullptr;
+                for (auto p = head; p != &e; prior = p, p = p->next) {}
+                (prior ? prior->next : head) = e.next;
+                if (tail == &e) tail = prior;
+                e.next = nullptr;
+                e.queued = false;
+                --m_size;
+            }
+            /// Resume every coroutine in the list, emptying it
+            void resume_all(boost::system::error_code ec = {}) {
+                while (auto e = pop_front()) e->resume(ec);
+            }
+
+            /// Suspend the coroutine at the back of the list until it is
+            /// resumed. The lock, which must be held, is released while the
+            /// coroutine is suspended and is held again when this returns or
+            /// throws. An error code given to `entry::resume` is thrown.
+            template<typename Y>
+            void wait(std::unique_lock<std::mutex> &lock, Y yield) {
+                using completion = boost::asio::async_completion<
+                        Y, void(boost::system::error_code)>;
+                completion init(yield);
+                parked<typename completion::completion_handler_type> e{
+                        std::move(init.completion_handler)};
+                push_back(e);
+                lock.unlock();
+                try {
+                    init.result.get();
+                } catch (...) {
+                    lock.lock();
+                    remove(e);
+                    throw;
+                }
+                lock.lock();
+            }
+        };
+
+
+    }
+
+
+}
@@ -0,0 +1,281 @@
+/**
+    Copyright 2026 Red Anchor Trading Co. Ltd.
+
+    Distributed under the Boost Software License, Version 1.0.
+    See <http://www.boost.org/LICENSE_1_0.txt>
+ */
+
+
+#pragma once
+
+
+#include <f5/threading/channel.hpp>
+#include <f5/threading/reactor.hpp>
+#include <f5/threading/suspend.hpp>
+
+#include <boost/asio/spawn.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+
+namespace f5 {
+
+
+    namespace boost_asio {
+
+
+        /// Whether a `transform` writes its results in the same order as
+        /// the items it read
+        enum class ordering { preserved, unordered };
+
+
+        /// A pipeline stage. It reads items from the input channel, passes
+        /// them through a function on a number of coroutines running on a
+        /// `reactor_pool`, and writes the results to the output channel.
+        /// `I` and `O` are the channel types.
+        ///
+        /// Each coroutine takes a batch of up to `batch` items at a time,
+        /// and the number of batches between being read and being written
+        /// is limited, so a slow output holds back the input. When the
+        /// order is preserved the results wait in a reorder buffer until
+        /// everything read before them has been written.
+        ///
+        /// The stage ends once the input has been closed and emptied, and
+        /// it then closes the output, so closing the first channel of a
+        /// pipeline shuts down each stage in turn. If the function throws
+        /// then the input and output are closed straight away and the
+        /// exception is rethrown from `wait`. The stage must not be
+        /// destroyed until `wait` has returned.
+        template<typename I, typename O>
+        class transform {
+          public:
+            /// The type of item read
+            using input_type = typename I::value_type;
+            /// The type of item written
+            using output_type = typename O::value_type;
+            /// The function applied to each item
+            using function_type = std::function<output_type(input_type)>;
+
+          private:
+            /// A batch of results waiting to be written, and the job that
+            /// holds its place in the limit on batches in flight
+            using pending =
+                    std::pair<std::vector<output_type>, fd::limiter::token>;
+
+            I &input;
+            O &output;
+            const function_type fn;
+            const ordering order;
+            const std::size_t batch;
+            /// Limits the number of batches in flight
+            fd::limiter throttle;
+
+            /// Mutex that controls access to everything below
+            std::mutex mutex;
+            /// Set while a coroutine is reading from the input in order
+            bool reading = false;
+            /// Coroutines waiting for their turn to read
+            wait_list readers;
+            /// The sequence numbers of the next batch to be read and
+            /// written
+            uint64_t next_read = {}, next_write = {};
+            /// Results waiting for earlier batches to be written, indexed
+            /// by sequence number modulo its size
+            std::vector<std::optional<pending>> reorder;
+            /// Set while a coroutine is writing from the reorder buffer
+            bool writing = false;
+            /// The number of coroutines still running
+            std::size_t running;
+            /// Coroutines waiting for the stage to end
+            wait_list finishing;
+            /// The first exception thrown by the function
+            std::exception_ptr failure;
+
+            /// Let the next coroutine waiting to read have its turn. The
+            /// lock must be held, and is released
+            void next_reader(std::unique_lock<std::mutex> &lock) {
+                reading = false;
+                auto reader = readers.pop_front();
+                lock.unlock();
+                if (reader) reader->resume();
+            }
+            /// Read the next batch, taking turns with the other coroutines
+            /// so that each batch gets the next sequence number. Returns
+            /// the sequence number
+            template<typename Y>
+            uint64_t read_in_turn(std::vector<input_type> &items, Y yield) {
+                std::unique_lock<std::mutex> lock{mutex};
+                while (reading) readers.wait(lock, yield);
+                reading = true;
+                lock.unlock();
+                try {
+                    items = input.consume_many(yield, batch);
+                } catch (...) {
+                    lock.lock();
+                    next_reader(lock);
+                    throw;
+                }
+                lock.lock();
+                auto const sequence = next_read++;
+                next_reader(lock);
+                return sequence;
+            }
+            /// Put the results in the reorder buffer and then, unless
+            /// another coroutine is already doing so, write out whatever is
+            /// now next
+            template<typename Y>
+            void write_in_order(uint64_t sequence, pending results, Y yield) {
+                std::unique_lock<std::mutex> lock{mutex};
+                reorder[sequence % reorder.size()] = std::move(results);
+                if (writing) return;
+                writing = true;
+                try {
+                    while (true) {
+                        auto &slot = reorder[next_write % reorder.size()];
+                        if (not slot) break;
+                        auto ready = std::move(*slot);
+                        slot.reset();
+                        ++next_write;
+                        lock.unlock();
+                        output.produce_many(std::move(ready.first), yield);
+                        lock.lock();
+                    }
+                } catch (...) {
+                    if (not lock) lock.lock();
+                    writing = false;
+                    throw;
+                }
+                writing = false;
+            }
+            /// The work done by each coroutine
+            template<typename Y>
+            void work(Y yield) {
+                try {
+                    std::vector<input_type> items;
+                    std::vector<output_type> results;
+                    while (true) {
+                        auto job = throttle.next_token(yield);
+                        uint64_t sequence{};
+                        if (order == ordering::preserved) {
+                            sequence = read_in_turn(items, yield);
+                        } else {
+                            items = input.consume_many(yield, batch);
+                        }
+                        results.clear();
+                        results.reserve(items.size());
+                        try {
+                            for (auto &item : items) {
+                                results.push_back(fn(std::move(item)));
+                            }
+                        } catch (...) {
+                            // Anything the function throws is a failure,
+                            // even a `system_error`
+                            failed(std::current_exception());
+                            break;
+                        }
+                        if (order == ordering::preserved) {
+                            write_in_order(
+                                    sequence,
+                                    pending{std::move(results), std::move(job)},
+                                    yield);
+                        } else {
+                            output.produce_many(std::move(results), yield);
+                        }
+                    }
+                } catch (boost::system::system_error &) {
+                    // One of the channels has been closed. Only the channel
+                    // operations get here as the function has its own
+                    // handler
+                } catch (boost::coroutines::detail::forced_unwind &) {
+                    throw;
+                } catch (...) {
+                    failed(std::current_exception());
+                }
+                finished();
+            }
+            /// Record the first failure and shut the stage down
+            void failed(std::exception_ptr e) {
+                std::unique_lock<std::mutex> lock{mutex};
+                if (not failure) failure = std::move(e);
+                lock.unlock();
+                // Results from the failed batch will never arrive, so stop
+                // the others from waiting for them
+                input.close();
+                throttle.close();
+                output.close();
+            }
+            /// Called as each coroutine ends. The last one closes the output
+            /// before it stops counting as running, because once `running`
+            /// reaches zero `wait` can return and the stage be destroyed, so
+            /// no member may be used after the lock is released
+            void finished() {
+                std::unique_lock<std::mutex> lock{mutex};
+                if (running > 1) {
+                    --running;
+                    return;
+                }
+                output.close();
+                --running;
+                auto waiting = std::move(finishing);
+                lock.unlock();
+                waiting.resume_all();
+            }
+
+          public:
+            /// Start the stage with `workers` coroutines on the pool. At
+            /// most `in_flight` batches are between being read and being
+            /// written, which defaults to twice the number of workers.
+            transform(
+                    reactor_pool &pool,
+                    I &input,
+                    O &output,
+                    function_type fn,
+                    std::size_t workers,
+                    ordering order = ordering::preserved,
+                    std::size_t batch = 1,
+                    std::size_t in_flight = 0)
+            : input(input),
+              output(output),
+              fn(std::move(fn)),
+              order(order),
+              batch(std::max<std::size_t>(batch, 1)),
+              throttle(
+                      pool.get_io_service(),
+                      in_flight ? in_flight : 2 * workers),
+              reorder(in_flight ? in_flight : 2 * workers),
+              running(workers) {
+                for (std::size_t w{}; w < workers; ++w) {
+                    boost::asio::spawn(
+                            pool.get_io_service(),
+                            [this](boost::asio::yield_context yield) {
+                                work(yield);
+                            });
+                }
+            }
+
+            /// Make non-copyable and non assignable
+            transform(const transform &) = delete;
+            transform &operator=(const transform &) = delete;
+
+            /// Yield until the stage has ended. Rethrows any exception
+            /// thrown by the function
+            template<typename Y>
+            void wait(Y yield) {
+                std::unique_lock<std::mutex> lock{mutex};
+                while (running) finishing.wait(lock, yield);
+                if (failure) std::rethrow_exception(failure);
+            }
+        };
+
+
+    }
+
+
+}
@@ -0,0 +1,379 @@
+/**
+    Copyright 2026 Red Anchor Trading Co. Ltd.
+
+    Distributed under the Boost Software License, Version 1.0.
+    See <http://www.boost.org/LICENSE_1_0.txt>
+ */
+
+
+#pragma once
+
+
+#include <f5/threading/suspend.hpp>
+
+#include <boost/asio/error.hpp>
+#include <boost/asio/io_service.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+
+namespace f5 {
+
+
+    namespace boost_asio {
+
+
+        /// A coroutine waiting for a limiter to start its job
+        struct limiter_waiter {
+            const uint64_t weight;
+            resumer resume;
+            /// Set once the weight has been reserved for the waiter
+            bool granted = false;
+        };
+
+
+        /// The machinery shared by the limiters whose waiting coroutines
+        /// are suspended until enough of the budget is free: reserving
+        /// weight, the move only tokens that give it back, waiting for all
+        /// outstanding jobs and closing.
+        ///
+        /// The queue `Q` decides which waiter is started next. It is only
+        /// used with the lock held and needs these members:
+        ///
+        /// * `place` -- the type saying where a new waiter goes.
+        /// * `push(place, std::shared_ptr<limiter_waiter>)` -- add a waiter.
+        /// * `next()` -- the waiter to start next, or `nullptr`.
+        /// * `pop()` -- remove the waiter `next` returned once started.
+        /// * `erase(const std::shared_ptr<limiter_waiter> &)` -- remove a
+        ///   waiter that is being abandoned, if it is still queued.
+        /// * `take_all()` -- remove and return all of the waiters.
+        template<typename Q>
+        class basic_weighted_limiter {
+          public:
+            /// A move only token for an outstanding job. The weight is
+            /// returned when the token is destroyed or `done` is called.
+            class token {
+                friend class basic_weighted_limiter;
+                /// The limiter that owns this job. Null once the job has
+                /// been completed or the token moved from
+                basic_weighted_limiter *limit = nullptr;
+                /// The weight reserved for the job
+                uint64_t m_weight = {};
+                /// Construct a token for a new job
+                token(basic_weighted_limiter &l, uint64_t w)
+                : limit(&l), m_weight(w) {}
+
+              public:
+                /// An empty token that doesn't represent any job
+                token() = default;
+                token(token &&t) noexcept
+                : limit(std::exchange(t.limit, nullptr)),
+                  m_weight(t.m_weight) {}
+                token &operator=(token &&t) noexcept {
+                    done();
+                    limit = std::exchange(t.limit, nullptr);
+                    m_weight = t.m_weight;
+                    return *this;
+                }
+                ~token() { done(); }
+
+                /// Returns true if the job hasn't been completed
+                explicit operator bool() const { return limit; }
+                /// The weight reserved for the job
+                uint64_t weight() const { return m_weight; }
+
+                /// Signal that the job is completed, if not already done so
+                void done() {
+                    if (limit) {
+                        std::exchange(limit, nullptr)->completed(m_weight);
+                    }
+                }
+            };
+
+          private:
+            /// The IO service
+            boost::asio::io_service &service;
+            /// Mutex that controls access to the counters and waiters
+            mutable std::mutex mutex;
+            /// The limit on the total weight. Zero means no limit
+            uint64_t m_limit;
+            /// The total weight of the outstanding jobs
+            uint64_t m_outstanding = {};
+            /// Coroutines waiting to start a job
+            Q waiting;
+            /// Coroutines waiting for all jobs to complete
+            std::vector<resumer> draining;
+            /// Set once the limiter has been closed
+            bool closed = false;
+
+            /// Return true if a job of this weight can start now. The lock
+            /// must be held
+            bool fits(uint64_t weight) const {
+                return not m_limit || not m_outstanding
+                        || m_outstanding + weight <= m_limit;
+            }
+            /// Reserve weight for as many of the waiters the queue picks as
+            /// now fit. Returns the coroutines to resume, which must be done
+            /// after the lock is released
+            std::vector<resumer> grant() {
+                std::vector<resumer> ready;
+                for (auto w = waiting.next(); w && fits(w->weight);
+                     w = waiting.next()) {
+                    m_outstanding += w->weight;
+                    w->granted = true;
+                    ready.push_back(w->resume);
+                    waiting.pop();
+                }
+                if (not m_outstanding) {
+                    for (auto &d : draining) ready.push_back(std::move(d));
+                    draining.clear();
+                }
+                return ready;
+            }
+            /// Return the weight to the budget and resume whoever can
+            /// now run
+            void completed(uint64_t weight) {
+                std::unique_lock<std::mutex> lock{mutex};
+                m_outstanding -= weight;
+                auto ready = grant();
+                lock.unlock();
+                for (auto &r : ready) r();
+            }
+
+          protected:
+            /// Construct with the given limit. Any further arguments are
+            /// passed on to the queue
+            template<typename... Args>
+            basic_weighted_limiter(
+                    boost::asio::io_service &ios,
+                    uint64_t limit,
+                    Args &&... args)
+            : service(ios),
+              m_limit(limit),
+              waiting(std::forward<Args>(args)...) {}
+
+            /// The queue of waiting coroutines
+            const Q &queue() const { return waiting; }
+
+            /// Reserve `weight` from the budget for a new job. The coroutine
+            /// is queued at `p` and suspended until the queue picks it and
+            /// the weight is available. Throws if the limiter is closed
+            template<typename Y>
+            token acquire(uint64_t weight, typename Q::place p, Y yield) {
+                std::unique_lock<std::mutex> lock{mutex};
+                if (closed) {
+                    throw boost::system::system_error(
+                            boost::asio::error::operation_aborted);
+                }
+                if (not waiting.next() && fits(weight)) {
+                    m_outstanding += weight;
+                    return token{*this, weight};
+                }
+                lock.unlock();
+                std::shared_ptr<limiter_waiter> w;
+                try {
+                    suspend(yield, [&](resumer r) {
+                        w = std::make_shared<limiter_waiter>(
+                                limiter_waiter{weight, std::move(r)});
+                        std::unique_lock<std::mutex> lock{mutex};
+                        if (closed) {
+                            lock.unlock();
+                            w->resume(boost::asio::error::operation_aborted);
+                            return;
+                        }
+                        waiting.push(p, w);
+                        // A job may have completed since we looked
+                        auto ready = grant();
+                        lock.unlock();
+                        for (auto &g : ready) g();
+                    });
+                } catch (...) {
+                    // Give back the weight, or our place in the queue, if
+                    // the coroutine is being abandoned
+                    std::unique_lock<std::mutex> lock{mutex};
+                    if (w && w->granted) {
+                        lock.unlock();
+                        completed(weight);
+                    } else if (w) {
+                        waiting.erase(w);
+                        auto ready = grant();
+                        lock.unlock();
+                        for (auto &r : ready) r();
+                    }
+                    throw;
+                }
+                return token{*this, weight};
+            }
+            /// Reserve `weight` for a new job only if it can start now.
+            /// Returns an empty token if it can't
+            token try_acquire(uint64_t weight) {
+                std::unique_lock<std::mutex> lock{mutex};
+                if (closed || waiting.next() || not fits(weight)) return {};
+                m_outstanding += weight;
+                return token{*this, weight};
+            }
+
+          public:
+            /// Make non-copyable and non assignable
+            basic_weighted_limiter(const basic_weighted_limiter &) = delete;
+            basic_weighted_limiter &
+                    operator=(const basic_weighted_limiter &) = delete;
+
+            /// Return the IO service
+            boost::asio::io_service &get_io_service() { return service; }
+
+            /// Increase the limit. Waiting jobs that now fit are started
+            uint64_t increase_limit(uint64_t l) {
+                std::unique_lock<std::mutex> lock{mutex};
+                auto const limit = m_limit += l;
+                auto ready = grant();
+                lock.unlock();
+                for (auto &r : ready) r();
+                return limit;
+            }
+            /// Decrease the limit. Jobs already started are unaffected
+            uint64_t decrease_limit(uint64_t l) {
+                std::unique_lock<std::mutex> lock{mutex};
+                return m_limit -= l;
+            }
+            /// The limit on the total weight of outstanding jobs
+            uint64_t limit() const {
+                std::unique_lock<std::mutex> lock{mutex};
+                return m_limit;
+            }
+            /// The current total weight of outstanding jobs
+            uint64_t outstanding() const {
+                std::unique_lock<std::mutex> lock{mutex};
+                return m_outstanding;
+            }
+
+            /// Complete all of the jobs represented by the range of tokens
+            /// together. Tokens from other limiters and empty tokens are
+            /// left untouched. Returns the total weight returned
+            template<typename I>
+            uint64_t complete_all(I first, I last) {
+                uint64_t weight{};
+                for (; first != last; ++first) {
+                    if (first->limit == this) {
+                        first->limit = nullptr;
+                        weight += first->m_weight;
+                    }
+                }
+                if (weight) completed(weight);
+                return weight;
+            }
+
+            /// Suspend the coroutine until there are no outstanding jobs.
+            /// Throws if the limiter is closed while there are still some
+            template<typename Y>
+            void wait_for_all_outstanding(Y yield) {
+                std::unique_lock<std::mutex> lock{mutex};
+                if (not m_outstanding) return;
+                lock.unlock();
+                suspend(yield, [this](resumer r) {
+                    std::unique_lock<std::mutex> lock{mutex};
+                    if (closed && m_outstanding) {
+                        lock.unlock();
+                        r(boost::asio::error::operation_aborted);
+                    } else if (m_outstanding) {
+                        draining.push_back(std::move(r));
+                    } else {
+                        lock.unlock();
+                        r();
+                    }
+                });
+            }
+
+            /// Close the limiter. Waiting coroutines, including those
+            /// waiting for all outstanding jobs, and any that try to start a
+            /// job later, get an `operation_aborted` error
+            void close() {
+                std::unique_lock<std::mutex> lock{mutex};
+                closed = true;
+                auto w = waiting.take_all();
+                auto d = std::move(draining);
+                draining.clear();
+                lock.unlock();
+                for (auto &r : w) {
+                    r->resume(boost::asio::error::operation_aborted);
+                }
+                for (auto &r : d) r(boost::asio::error::operation_aborted);
+            }
+        };
+
+
+        /// Waiting coroutines served strictly in the order they arrived
+        class arrival_order {
+            std::deque<std::shared_ptr<limiter_waiter>> waiting;
+
+          public:
+            /// There is only the one queue
+            struct place {};
+
+            void push(place, std::shared_ptr<limiter_waiter> w) {
+                waiting.push_back(std::move(w));
+            }
+            limiter_waiter *next() const {
+                return waiting.empty() ? nullptr : waiting.front().get();
+            }
+            void pop() { waiting.pop_front(); }
+            void erase(const std::shared_ptr<limiter_waiter> &w) {
+                auto const pos = std::find(waiting.begin(), waiting.end(), w);
+                if (pos != waiting.end()) waiting.erase(pos);
+            }
+            std::deque<std::shared_ptr<limiter_waiter>> take_all() {
+                return std::exchange(waiting, {});
+            }
+        };
+
+
+        /// Limits the total weight of the outstanding jobs rather than
+        /// their number, for example the bytes in flight. A job reserves
+        /// its weight from the budget and returns it when it completes.
+        ///
+        /// Waiting coroutines are served strictly in the order they
+        /// arrived, so a large job can't be starved by a stream of small
+        /// ones that would each fit. A job heavier than the whole limit is
+        /// started once nothing else is outstanding.
+        ///
+        /// `next_token` reserves a weight of one, so the limiter can also
+        /// be used as the limiter of a `channel`.
+        class weighted_limiter : public basic_weighted_limiter<arrival_order> {
+          public:
+            /// Construct with the given limit on the total weight
+            weighted_limiter(boost::asio::io_service &ios, uint64_t limit)
+            : basic_weighted_limiter(ios, limit) {}
+
+            /// Reserve `weight` from the budget for a new job. The coroutine
+            /// is suspended until the weight is available and every job that
+            /// was waiting before it has started. Throws if the limiter is
+            /// closed
+            template<typename Y>
+            token next_job(uint64_t weight, Y yield) {
+                return acquire(weight, {}, yield);
+            }
+            /// Reserve a weight of one for a new job
+            template<typename Y>
+            token next_token(Y yield) {
+                return next_job(1, yield);
+            }
+
+            /// Reserve `weight` for a new job only if it can start now.
+            /// Returns an empty token if it can't
+            token try_next_job(uint64_t weight) { return try_acquire(weight); }
+            /// Reserve a weight of one for a new job only if it can start
+            /// now
+            token try_next_token() { return try_acquire(1); }
+        };
+
+
+    }
+
+
+}
@@ -0,0 +1,124 @@
+#include <f5/threading/limiters.hpp>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+
+/**
+    Compares signalling through a pipe with signalling through an
+    eventfd. For `unlimited` a producer thread signals items in bursts
+    while a coroutine consumes them. The eventfd is measured in both
+    semaphore mode, where each wait takes one item, and counter mode,
+    where each wait takes everything signalled so far. For `limiter` a
+    coroutine takes jobs which a worker thread completes in batches, so
+    the coroutine waits whenever the limit is reached. This is measured
+    for `job` and for tokens with batched completion.
+ */
+
+
+template<typename F>
+double ns_per_item(std::size_t items, F fn) {
+    auto const start = std::chrono::steady_clock::now();
+    fn();
+    std::chrono::duration<double, std::nano> const taken =
+            std::chrono::steady_clock::now() - start;
+    return taken.count() / items;
+}
+
+
+template<typename D>
+double unlimited(std::size_t burst, f5::threading::fd::counting c) {
+    std::size_t const items = 100'000;
+    boost::asio::io_service ios;
+    f5::threading::fd::basic_unlimited<D> ul{ios, c};
+    return ns_per_item(items, [&]() {
+        std::size_t consumed{};
+        boost::asio::spawn(ios, [&](auto yield) {
+            while (consumed < items) consumed += ul.consume(yield);
+        });
+        std::thread producer{[&]() {
+            for (std::size_t n{}; n < items; n += burst) ul.produced(burst);
+        }};
+        ios.run();
+        producer.join();
+    });
+}
+
+
+/// When `Tokens` is true the jobs are allocation free tokens which the
+/// worker completes in a single batch. Otherwise they are `job` instances
+/// completed one at a time.
+template<typename D, bool Tokens>
+double limiter(std::size_t limit) {
+    using limiter_type = f5::threading::fd::basic_limiter<D>;
+    using job_type = std::conditional_t<
+            Tokens, typename limiter_type::token,
+            std::unique_ptr<typename limiter_type::job>>;
+    std::size_t const items = 100'000;
+    boost::asio::io_service ios;
+    limiter_type throttle{ios, limit};
+    std::mutex mutex;
+    std::vector<job_type> pending;
+    std::atomic<bool> finished{false};
+    return ns_per_item(items, [&]() {
+        boost::asio::spawn(ios, [&](auto yield) {
+            for (std::size_t n{}; n < items; ++n) {
+                job_type job;
+                if constexpr (Tokens) {
+                    job = throttle.next_token(yield);
+                } else {
+                    job = throttle.next_job(yield);
+                }
+                std::lock_guard<std::mutex> lock{mutex};
+                pending.push_back(std::move(job));
+            }
+            throttle.wait_for_all_outstanding(yield);
+            finished = true;
+        });
+        std::thread worker{[&]() {
+            std::vector<job_type> completing;
+            while (not finished) {
+                {
+                    std::lock_guard<std::mutex> lock{mutex};
+                    completing.swap(pending);
+                }
+                if (completing.empty()) {
+                    std::this_thread::yield();
+                } else if constexpr (Tokens) {
+                    throttle.complete_all(completing.begin(), completing.end());
+                }
+                completing.clear();
+            }
+        }};
+        ios.run();
+        worker.join();
+    });
+}
+
+
+int main() {
+    using f5::threading::fd::counting;
+    using f5::threading::fd::eventfd;
+    using f5::threading::fd::pipe;
+    for (std::size_t const n : {1u, 16u, 256u}) {
+        std::cout << "unlimited, bursts of " << n << ": pipe "
+                  << unlimited<pipe>(n, counting::semaphore)
+                  << "ns, eventfd semaphore "
+                  << unlimited<eventfd>(n, counting::semaphore)
+                  << "ns, eventfd counter "
+                  << unlimited<eventfd>(n, counting::counter)
+                  << "ns per item" << std::endl;
+    }
+    for (std::size_t const n : {1u, 16u, 256u}) {
+        std::cout << "limiter, limit of " << n << ": pipe "
+                  << limiter<pipe, false>(n) << "ns, eventfd "
+                  << limiter<eventfd, false>(n) << "ns, eventfd tokens "
+                  << limiter<eventfd, true>(n) << "ns per item" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,63 @@
+#include <f5/threading/queue.hpp>
+#include <f5/threading/segmented.hpp>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+
+/**
+    Compares the default `std::deque` store for `queue`, which is guarded
+    by the queue's own mutex, with the `segmented_store` under contention.
+    For each size there are that many producer threads and that many
+    consumer coroutines, with the IO service run on that many threads.
+ */
+
+
+template<typename F>
+double ns_per_item(std::size_t items, F fn) {
+    auto const start = std::chrono::steady_clock::now();
+    fn();
+    std::chrono::duration<double, std::nano> const taken =
+            std::chrono::steady_clock::now() - start;
+    return taken.count() / items;
+}
+
+
+template<typename S>
+double contention(std::size_t threads) {
+    std::size_t const items = 131'072, each = items / threads;
+    boost::asio::io_service ios;
+    f5::boost_asio::queue<std::size_t, S> queue{ios};
+    return ns_per_item(items, [&]() {
+        for (std::size_t c{}; c < threads; ++c) {
+            boost::asio::spawn(ios, [&](auto yield) {
+                for (std::size_t n{}; n < each; ++n) queue.consume(yield);
+            });
+        }
+        std::vector<std::thread> running;
+        for (std::size_t t{}; t < threads; ++t) {
+            running.emplace_back([&ios]() { ios.run(); });
+        }
+        for (std::size_t p{}; p < threads; ++p) {
+            running.emplace_back([&]() {
+                for (std::size_t n{}; n < each; ++n) queue.produce(n);
+            });
+        }
+        for (auto &t : running) t.join();
+    });
+}
+
+
+int main() {
+    for (std::size_t const n : {1u, 2u, 4u, 8u, 16u, 32u, 64u}) {
+        std::cout << n << " producers and consumers: deque "
+                  << contention<std::deque<std::size_t>>(n)
+                  << "ns, segmented "
+                  << contention<f5::segmented_store<std::size_t>>(n)
+                  << "ns per item" << std::endl;
+    }
+    return 0;
+}
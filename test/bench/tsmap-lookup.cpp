@@ -0,0 +1,92 @@
+#include <f5/threading/map.hpp>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+
+
+/**
+    Compares searching for integer keys in the original interleaved
+    key/value layout with searching the separate key array that `tsmap`
+    now uses. The time for a complete `tsmap::find`, which includes the
+    locking and copying out the value, is also shown.
+    Sizes can be given on the command line, otherwise 1k, 100k and 10M
+    entries are measured.
+ */
+
+
+using key_type = std::int64_t;
+using value_type = std::shared_ptr<std::int64_t>;
+
+
+template<typename F>
+double ns_per_lookup(std::size_t lookups, F fn) {
+    auto const start = std::chrono::steady_clock::now();
+    fn();
+    std::chrono::duration<double, std::nano> const taken =
+            std::chrono::steady_clock::now() - start;
+    return taken.count() / lookups;
+}
+
+
+void measure(std::size_t entries) {
+    std::vector<std::pair<key_type, value_type>> pairs;
+    pairs.reserve(entries);
+    for (std::size_t n{}; n < entries; ++n) {
+        pairs.emplace_back(2 * n, std::make_shared<key_type>(n));
+    }
+    f5::tsmap<key_type, value_type> map;
+    map.assign_range(pairs);
+
+    std::size_t const lookups = 2'000'000;
+    std::vector<key_type> probes(lookups);
+    std::mt19937_64 rng{entries};
+    std::uniform_int_distribution<key_type> key{0, key_type(2 * entries)};
+    for (auto &p : probes) p = key(rng);
+
+    std::vector<key_type> keys;
+    keys.reserve(entries);
+    for (auto const &p : pairs) keys.push_back(p.first);
+
+    std::size_t found_pairs{}, found_keys{}, found_map{};
+    auto const interleaved = ns_per_lookup(lookups, [&]() {
+        for (auto const k : probes) {
+            auto const bound = std::lower_bound(
+                    pairs.begin(), pairs.end(), k,
+                    [](auto const &l, auto const &r) { return l.first < r; });
+            found_pairs += bound != pairs.end() && bound->first == k;
+        }
+    });
+    auto const separate = ns_per_lookup(lookups, [&]() {
+        for (auto const k : probes) {
+            auto const i =
+                    f5::branchless_lower_bound(keys.data(), keys.size(), k);
+            found_keys += i != keys.size() && keys[i] == k;
+        }
+    });
+    auto const find = ns_per_lookup(lookups, [&]() {
+        for (auto const k : probes) found_map += bool(map.find(k));
+    });
+    if (found_pairs != found_keys || found_pairs != found_map) {
+        std::cerr << "Look ups disagree: " << found_pairs << ", "
+                  << found_keys << ", " << found_map << std::endl;
+        std::exit(1);
+    }
+
+    std::cout << entries << " entries: interleaved " << interleaved
+              << "ns, separate keys " << separate << "ns, tsmap::find "
+              << find << "ns per look up" << std::endl;
+}
+
+
+int main(int argc, char *argv[]) {
+    if (argc > 1) {
+        for (int a{1}; a < argc; ++a) measure(std::stoull(argv[a]));
+    } else {
+        for (std::size_t const s : {1'000u, 100'000u, 10'000'000u}) {
+            measure(s);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1 @@
+#include <f5/threading/hashmap.hpp>
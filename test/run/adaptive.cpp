@@ -0,0 +1,116 @@
+#include <f5/threading/adaptive.hpp>
+#include <cassert>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+
+using namespace std::chrono_literals;
+
+
+void test_aimd() {
+    boost::asio::io_service ios;
+    f5::threading::fd::adaptive_limiter<f5::threading::fd::aimd> limit{
+            ios, 4, 1, 100, f5::threading::fd::aimd{50ms}};
+    boost::asio::spawn(ios, [&](auto yield) {
+        // Keep the limiter full so that every fast sample grows the limit
+        std::vector<decltype(limit.next_job(yield))> jobs;
+        for (int n{}; n < 4; ++n) jobs.push_back(limit.next_job(yield));
+        for (int n{}; n < 4; ++n) {
+            jobs[n].done();
+            jobs[n] = limit.next_job(yield);
+        }
+        auto const grown = limit.stats();
+        assert(grown.samples == 4u);
+        assert(grown.increases == 4u);
+        assert(grown.limit == 8u && limit.limit() == 8u);
+        jobs.clear();
+        auto const before = limit.limit();
+
+        auto slow = limit.next_job(yield);
+        std::this_thread::sleep_for(60ms);
+        slow.done();
+        auto const cut = limit.stats();
+        assert(cut.decreases == 1u);
+        assert(cut.limit == before * 9 / 10);
+        assert(limit.limit() == cut.limit);
+        assert(cut.rtt >= 60ms);
+        assert(cut.min_rtt < 50ms);
+    });
+    ios.run();
+}
+
+
+void test_gradient() {
+    boost::asio::io_service ios;
+    f5::threading::fd::adaptive_limiter<> limit{ios, 20};
+    boost::asio::spawn(ios, [&](auto yield) {
+        // Long enough that scheduling jitter doesn't look like queueing
+        for (int n{}; n < 10; ++n) {
+            auto job = limit.next_job(yield);
+            std::this_thread::sleep_for(5ms);
+        }
+        auto const fast = limit.stats();
+        assert(fast.limit > 20u);
+        assert(fast.decreases == 0u);
+        // Latency well above the minimum brings the limit down
+        for (int n{}; n < 10; ++n) {
+            auto job = limit.next_job(yield);
+            std::this_thread::sleep_for(50ms);
+        }
+        auto const slow = limit.stats();
+        assert(slow.limit < fast.limit);
+        assert(slow.decreases > 0u);
+        assert(slow.rtt > slow.min_rtt);
+    });
+    ios.run();
+}
+
+
+/// A rise in latency brings a small limit down, and a lasting rise
+/// eventually becomes the new baseline
+void test_gradient_small() {
+    boost::asio::io_service ios;
+    f5::threading::fd::adaptive_limiter<> limit{ios, 4, 1, 4};
+    boost::asio::spawn(ios, [&](auto yield) {
+        for (int n{}; n < 5; ++n) {
+            auto job = limit.next_job(yield);
+            std::this_thread::sleep_for(5ms);
+        }
+        assert(limit.limit() == 4u);
+        auto const baseline = limit.stats().min_rtt;
+        for (int n{}; n < 10; ++n) {
+            auto job = limit.next_job(yield);
+            std::this_thread::sleep_for(50ms);
+        }
+        auto const slow = limit.stats();
+        assert(slow.limit < 4u && limit.limit() == slow.limit);
+        assert(slow.decreases > 0u);
+        assert(slow.min_rtt > baseline);
+        assert(slow.min_rtt < 50ms);
+    });
+    ios.run();
+}
+
+
+/// The initial limit is kept within the bounds, so a zero limit doesn't
+/// leave the limiter unlimited until the first sample arrives
+void test_initial_bounds() {
+    boost::asio::io_service ios;
+    f5::threading::fd::adaptive_limiter<> zero{ios, 0, 2, 10};
+    assert(zero.limit() == 2u);
+    assert(zero.stats().limit == 2u);
+
+    f5::threading::fd::adaptive_limiter<> large{ios, 50, 1, 10};
+    assert(large.limit() == 10u);
+    assert(large.stats().limit == 10u);
+}
+
+
+int main() {
+    test_aimd();
+    test_gradient();
+    test_gradient_small();
+    test_initial_bounds();
+    return 0;
+}
@@ -0,0 +1,54 @@
+#include <f5/threading/channel.hpp>
+#include <cassert>
+#include <vector>
+
+
+/// A batch larger than the channel is added in pieces as space is freed,
+/// and each consumed batch frees its space in one go
+void test_batches() {
+    boost::asio::io_service ios;
+    f5::boost_asio::channel<int> channel{ios, 4};
+    std::vector<int> seen;
+    std::vector<std::size_t> sizes;
+    boost::asio::spawn(ios, [&](auto yield) {
+        std::vector<int> items(10);
+        for (int n{}; n < 10; ++n) items[n] = n;
+        channel.produce_many(std::move(items), yield);
+    });
+    boost::asio::spawn(ios, [&](auto yield) {
+        while (seen.size() < 10) {
+            auto got = channel.consume_many(yield, 3);
+            assert(got.size() && got.size() <= 3);
+            sizes.push_back(got.size());
+            seen.insert(seen.end(), got.begin(), got.end());
+        }
+        channel.wait_for_all_outstanding(yield);
+    });
+    ios.run();
+    assert((seen == std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+    assert(sizes.front() == 3);
+}
+
+
+/// Single items and batches can be mixed
+void test_mixed() {
+    boost::asio::io_service ios;
+    f5::boost_asio::channel<int> channel{ios, 8};
+    std::vector<int> seen;
+    boost::asio::spawn(ios, [&](auto yield) {
+        channel.produce(1, yield);
+        std::vector<int> const items{2, 3};
+        channel.produce_many(items, yield);
+        for (auto v : channel.consume_many(yield, 8)) seen.push_back(v);
+        assert(channel.size() == 8);
+    });
+    ios.run();
+    assert((seen == std::vector<int>{1, 2, 3}));
+}
+
+
+int main() {
+    test_batches();
+    test_mixed();
+    return 0;
+}
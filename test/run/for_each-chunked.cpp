@@ -0,0 +1,82 @@
+#include <f5/threading/map.hpp>
+#include <f5/threading/set.hpp>
+#include <atomic>
+#include <cassert>
+#include <thread>
+
+
+void test_tsmap() {
+    f5::tsmap<int, std::shared_ptr<int>> map;
+    for (int n{}; n < 1000; n += 2) {
+        map.insert_or_assign(n, std::make_shared<int>(n));
+    }
+
+    std::atomic<bool> stop{false};
+    std::thread writer{[&]() {
+        for (int n{1}; not stop; n = (n + 2) % 1000) {
+            map.insert_or_assign(n, std::make_shared<int>(n));
+            map.remove(n);
+        }
+    }};
+    for (int pass{}; pass < 20; ++pass) {
+        int last{-1}, evens{};
+        map.for_each_chunked(
+                [&](int k, auto const &v) {
+                    assert(k > last && *v == k);
+                    last = k;
+                    evens += (k % 2) == 0;
+                },
+                7);
+        assert(evens == 500);
+    }
+    stop = true;
+    writer.join();
+
+    int count{};
+    map.for_each_range(10, 20, [&count](int k, auto const &) {
+        assert(k >= 10 && k < 20);
+        ++count;
+    });
+    assert(count == 5);
+}
+
+
+void test_tsset() {
+    f5::tsset<int> set;
+    for (int n{}; n < 100; ++n) set.insert_if_not_found(n);
+    int last{-1}, count{};
+    set.for_each_chunked(
+            [&](int v) {
+                assert(v == last + 1);
+                last = v;
+                ++count;
+            },
+            8);
+    assert(count == 100);
+
+    int total{};
+    set.for_each_range(5, 8, [&total](int v) { total += v; });
+    assert(total == 5 + 6 + 7);
+}
+
+
+/// A chunk size of zero is treated as one
+void test_zero_chunk() {
+    f5::tsmap<int, std::shared_ptr<int>> map;
+    f5::tsset<int> set;
+    for (int n{}; n < 10; ++n) {
+        map.insert_or_assign(n, std::make_shared<int>(n));
+        set.insert_if_not_found(n);
+    }
+    int count{};
+    map.for_each_chunked([&count](int, auto const &) { ++count; }, 0);
+    set.for_each_chunked([&count](int) { ++count; }, 0);
+    assert(count == 20);
+}
+
+
+int main() {
+    test_tsmap();
+    test_tsset();
+    test_zero_chunk();
+}
@@ -0,0 +1,116 @@
+#include <f5/threading/limiters.hpp>
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <vector>
+
+
+/// Several producers share a limiter while a consumer completes the jobs
+/// in batches, so each wait can see more than one completion.
+template<typename D>
+void test_limiter() {
+    using limiter_type = f5::threading::fd::basic_limiter<D>;
+    boost::asio::io_service ios;
+    limiter_type limit{ios, 4};
+    std::vector<std::unique_ptr<typename limiter_type::job>> jobs;
+    std::size_t started{}, most{};
+
+    for (int p{}; p < 3; ++p) {
+        boost::asio::spawn(ios, [&](auto yield) {
+            for (int n{}; n < 20; ++n) {
+                jobs.push_back(limit.next_job(yield));
+                ++started;
+                most = std::max<std::size_t>(most, limit.outstanding());
+            }
+        });
+    }
+    boost::asio::spawn(ios, [&](auto yield) {
+        boost::asio::deadline_timer timer{ios};
+        while (started < 60u) {
+            timer.expires_from_now(boost::posix_time::milliseconds(1));
+            timer.async_wait(yield);
+            jobs.clear();
+        }
+        jobs.clear();
+        limit.wait_for_all_outstanding(yield);
+    });
+    ios.run();
+
+    assert(started == 60u);
+    assert(most <= 4u);
+    assert(limit.outstanding() == 0u);
+}
+
+
+template<typename D>
+void test_tokens() {
+    using limiter_type = f5::threading::fd::basic_limiter<D>;
+    boost::asio::io_service ios;
+    limiter_type limit{ios, 8};
+    std::vector<typename limiter_type::token> tokens;
+    std::size_t started{};
+
+    boost::asio::spawn(ios, [&](auto yield) {
+        for (int n{}; n < 100; ++n) {
+            tokens.push_back(limit.next_token(yield));
+            ++started;
+            assert(limit.outstanding() <= 8u);
+        }
+    });
+    boost::asio::spawn(ios, [&](auto yield) {
+        boost::asio::deadline_timer timer{ios};
+        while (started < 100u || limit.outstanding()) {
+            timer.expires_from_now(boost::posix_time::milliseconds(1));
+            timer.async_wait(yield);
+            auto const outstanding = limit.outstanding();
+            assert(limit.complete_all(tokens.begin(), tokens.end())
+                   == outstanding);
+            assert(limit.complete_all(tokens.begin(), tokens.end()) == 0u);
+            tokens.clear();
+        }
+    });
+    ios.run();
+    assert(started == 100u);
+
+    auto moved = [&]() {
+        typename limiter_type::token t;
+        assert(not t);
+        boost::asio::spawn(ios, [&](auto yield) {
+            t = limit.next_token(yield);
+        });
+        ios.restart();
+        ios.run();
+        assert(t && limit.outstanding() == 1u);
+        return t;
+    }();
+    assert(moved && limit.outstanding() == 1u);
+    moved.done();
+    assert(not moved && limit.outstanding() == 0u);
+}
+
+
+template<typename D>
+void test_unlimited_burst() {
+    boost::asio::io_service ios;
+    f5::threading::fd::basic_unlimited<D> ul{ios};
+    ul.produced(1000);
+    std::size_t consumed{};
+    boost::asio::spawn(ios, [&](auto yield) {
+        while (consumed < 1000u) consumed += ul.consume(yield);
+    });
+    ios.run();
+    assert(consumed == 1000u);
+}
+
+
+int main() {
+    test_limiter<f5::threading::fd::pipe>();
+    test_tokens<f5::threading::fd::pipe>();
+    test_unlimited_burst<f5::threading::fd::pipe>();
+#ifdef __linux__
+    test_limiter<f5::threading::fd::eventfd>();
+    test_tokens<f5::threading::fd::eventfd>();
+    test_unlimited_burst<f5::threading::fd::eventfd>();
+#endif
+    return 0;
+}
@@ -0,0 +1,129 @@
+#include <f5/threading/channel.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <string>
+#include <vector>
+
+
+using limiter_type = f5::boost_asio::priority_limiter;
+
+
+/// Fill the limiter, queue waiters in each class and then free the
+/// capacity one job at a time, recording which class gets each slot
+std::vector<std::size_t> admission_order(
+        limiter_type &limit,
+        boost::asio::io_service &ios,
+        std::size_t per_class) {
+    std::vector<std::size_t> order;
+    limiter_type::token held;
+    boost::asio::spawn(
+            ios, [&](auto yield) { held = limit.next_token(0, yield); });
+    for (std::size_t c{}; c < limit.priorities(); ++c) {
+        for (std::size_t n{}; n < per_class; ++n) {
+            boost::asio::spawn(ios, [&, c](auto yield) {
+                auto job = limit.next_token(c, yield);
+                order.push_back(c);
+                boost::asio::steady_timer timer{ios};
+                timer.expires_after(std::chrono::milliseconds{1});
+                timer.async_wait(yield);
+            });
+        }
+    }
+    boost::asio::spawn(ios, [&](auto yield) {
+        boost::asio::steady_timer timer{ios};
+        timer.expires_after(std::chrono::milliseconds{10});
+        timer.async_wait(yield);
+        assert(order.empty());
+        held.done();
+        limit.wait_for_all_outstanding(yield);
+    });
+    ios.run();
+    return order;
+}
+
+
+void test_strict() {
+    boost::asio::io_service ios;
+    limiter_type limit{ios, 1, 3};
+    auto const order = admission_order(limit, ios, 2);
+    assert((order == std::vector<std::size_t>{0, 0, 1, 1, 2, 2}));
+}
+
+
+void test_shares() {
+    boost::asio::io_service ios;
+    limiter_type limit{ios, 1, std::vector<uint64_t>{3, 1}};
+    auto const order = admission_order(limit, ios, 4);
+    assert(order.size() == 8u);
+    // The low priority class gets a quarter of the slots while both are
+    // waiting, rather than none of them
+    assert(std::count(order.begin(), order.begin() + 4, 1u) == 1);
+}
+
+
+void test_channel() {
+    boost::asio::io_service ios;
+    f5::boost_asio::channel<std::string, limiter_type> channel{ios, 1, 2};
+    std::vector<std::string> seen;
+    boost::asio::spawn(ios, [&](auto yield) {
+        channel.produce("first", 0, yield);
+    });
+    boost::asio::spawn(ios, [&](auto yield) {
+        channel.produce("batch", yield);
+    });
+    boost::asio::spawn(ios, [&](auto yield) {
+        channel.produce("interactive", 0, yield);
+    });
+    boost::asio::spawn(ios, [&](auto yield) {
+        for (int n{}; n < 3; ++n) seen.push_back(channel.consume(yield));
+    });
+    ios.run();
+    assert((seen == std::vector<std::string>{"first", "interactive", "batch"}));
+}
+
+
+void test_close() {
+    boost::asio::io_service ios;
+    limiter_type limit{ios, 1};
+    bool aborted = false;
+    limiter_type::token held;
+    boost::asio::spawn(ios, [&](auto yield) {
+        held = limit.next_token(yield);
+        try {
+            limit.next_token(yield);
+        } catch (boost::system::system_error &) { aborted = true; }
+    });
+    boost::asio::spawn(ios, [&](auto) { limit.close(); });
+    ios.run();
+    assert(aborted);
+}
+
+
+/// Closing the limiter wakes a coroutine waiting for outstanding jobs
+void test_close_while_draining() {
+    boost::asio::io_service ios;
+    limiter_type limit{ios, 2};
+    bool aborted = false;
+    auto held = limit.try_next_token();
+    boost::asio::spawn(ios, [&](auto yield) {
+        try {
+            limit.wait_for_all_outstanding(yield);
+        } catch (boost::system::system_error &) { aborted = true; }
+    });
+    boost::asio::spawn(ios, [&](auto) { limit.close(); });
+    ios.run();
+    assert(aborted);
+    assert(limit.outstanding() == 1u);
+}
+
+
+int main() {
+    test_strict();
+    test_shares();
+    test_channel();
+    test_close();
+    test_close_while_draining();
+    return 0;
+}
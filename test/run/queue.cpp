@@ -0,0 +1,150 @@
+#include <f5/threading/queue.hpp>
+#include <f5/threading/segmented.hpp>
+#include <boost/asio/io_service.hpp>
+#include <atomic>
+#include <cassert>
+#include <thread>
+#include <vector>
+
+
+/// Consumers park on an empty queue and are then woken by bursts from
+/// another thread
+void test_parked_consumers() {
+    boost::asio::io_service ios;
+    f5::boost_asio::queue<int> queue{ios};
+    std::atomic<int> total{};
+    for (int c{}; c < 4; ++c) {
+        boost::asio::spawn(ios, [&](auto yield) {
+            for (int n{}; n < 250; ++n) total += queue.consume(yield);
+        });
+    }
+    std::vector<std::thread> threads;
+    for (int t{}; t < 4; ++t) threads.emplace_back([&ios]() { ios.run(); });
+    std::thread producer{[&]() {
+        for (int n{}; n < 1000; ++n) {
+            queue.produce(1);
+            if (n % 100 == 0) std::this_thread::yield();
+        }
+    }};
+    producer.join();
+    for (auto &t : threads) t.join();
+    assert(total == 1000);
+}
+
+
+/// Items produced with nobody waiting are consumed without parking
+void test_unparked() {
+    boost::asio::io_service ios;
+    f5::boost_asio::queue<int> queue{ios};
+    for (int n{}; n < 100; ++n) queue.produce(n);
+    int total{};
+    boost::asio::spawn(ios, [&](auto yield) {
+        for (int n{}; n < 100; ++n) total += queue.consume(yield);
+    });
+    ios.run();
+    assert(total == 4950);
+}
+
+
+/// The non-blocking consume only returns items that no other consumer has
+/// claimed
+void test_try_consume() {
+    boost::asio::io_service ios;
+    f5::boost_asio::queue<int> queue{ios};
+    assert(not queue.consume());
+    queue.produce(3);
+    assert(queue.consume() == 3);
+    assert(not queue.consume());
+}
+
+
+/// Items go in and out of a segmented store in order across segments
+void test_segmented_store() {
+    f5::segmented_store<int, 4> store;
+    assert(not store.try_pop_front());
+    for (int round{}; round < 3; ++round) {
+        for (int n{}; n < 10; ++n) store.push_back(n);
+        for (int n{}; n < 10; ++n) assert(store.try_pop_front() == n);
+        assert(not store.try_pop_front());
+    }
+}
+
+
+/// Many producer threads and consumers on many threads share a queue
+/// backed by a segmented store
+void test_segmented_queue() {
+    boost::asio::io_service ios;
+    f5::boost_asio::queue<int, f5::segmented_store<int, 8>> queue{ios};
+    std::atomic<int> total{}, count{};
+    for (int c{}; c < 8; ++c) {
+        boost::asio::spawn(ios, [&](auto yield) {
+            for (int n{}; n < 500; ++n) {
+                total += queue.consume(yield);
+                ++count;
+            }
+        });
+    }
+    std::vector<std::thread> threads;
+    for (int t{}; t < 4; ++t) threads.emplace_back([&ios]() { ios.run(); });
+    std::vector<std::thread> producers;
+    for (int p{}; p < 4; ++p) {
+        producers.emplace_back([&]() {
+            for (int n{}; n < 1000; ++n) queue.produce(n);
+        });
+    }
+    for (auto &p : producers) p.join();
+    for (auto &t : threads) t.join();
+    assert(count == 4000);
+    assert(total == 4 * 499500);
+    assert(not queue.consume());
+}
+
+
+/// Batches are produced and consumed in order, never more than asked for
+void test_many() {
+    boost::asio::io_service ios;
+    f5::boost_asio::queue<int> queue{ios};
+    std::vector<std::size_t> sizes;
+    std::vector<int> seen;
+    boost::asio::spawn(ios, [&](auto yield) {
+        while (seen.size() < 10) {
+            auto got = queue.consume_many(yield, 4);
+            sizes.push_back(got.size());
+            seen.insert(seen.end(), got.begin(), got.end());
+        }
+    });
+    ios.poll();
+    assert(queue.produce_many(std::vector<int>{0, 1, 2, 3, 4, 5}) == 6u);
+    std::vector<int> const rest{6, 7, 8, 9};
+    queue.produce_many(rest);
+    ios.run();
+    assert((seen == std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+    assert((sizes == std::vector<std::size_t>{4, 4, 2}));
+}
+
+
+/// Asking for no items takes one rather than spinning
+void test_many_zero() {
+    boost::asio::io_service ios;
+    f5::boost_asio::queue<int> queue{ios};
+    queue.produce_many(std::vector<int>{1, 2});
+    std::vector<int> seen;
+    boost::asio::spawn(ios, [&](auto yield) {
+        auto got = queue.consume_many(yield, 0);
+        seen.insert(seen.end(), got.begin(), got.end());
+    });
+    ios.run();
+    assert((seen == std::vector<int>{1}));
+}
+
+
+int main() {
+    test_parked_consumers();
+    test_unparked();
+    test_try_consume();
+    test_segmented_store();
+    test_segmented_queue();
+    test_many();
+    test_many_zero();
+    return 0;
+}
@@ -0,0 +1,70 @@
+#include <f5/threading/rate.hpp>
+#include <cassert>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+
+using namespace std::chrono_literals;
+
+
+void test_try_acquire() {
+    boost::asio::io_service ios;
+    f5::boost_asio::rate_limiter rate{ios, 10, 1s, 3};
+    assert(rate.try_acquire());
+    assert(rate.try_acquire(2));
+    assert(not rate.try_acquire());
+    std::this_thread::sleep_for(150ms);
+    assert(rate.try_acquire());
+    assert(not rate.try_acquire());
+}
+
+
+/// A rate that can't be represented is rejected
+void test_invalid() {
+    boost::asio::io_service ios;
+    auto const rejected = [&](uint64_t count, auto period) {
+        try {
+            f5::boost_asio::rate_limiter rate{ios, count, period};
+            return false;
+        } catch (std::invalid_argument &) { return true; }
+    };
+    assert(rejected(0, 1s));
+    assert(rejected(10, 5ns));
+    assert(not rejected(10, 10ns));
+}
+
+
+/// Many coroutines share the rate. The burst goes through straight away
+/// and the rest are spaced out at the rate
+void test_waiters() {
+    boost::asio::io_service ios;
+    f5::boost_asio::rate_limiter rate{ios, 100, 1s, 5};
+    using clock = f5::boost_asio::rate_limiter::clock_type;
+    auto const start = clock::now();
+    std::vector<clock::duration> times;
+    for (int c{}; c < 5; ++c) {
+        boost::asio::spawn(ios, [&](auto yield) {
+            for (int n{}; n < 5; ++n) {
+                rate.acquire(yield);
+                times.push_back(clock::now() - start);
+            }
+        });
+    }
+    ios.run();
+    assert(times.size() == 25u);
+    // Allow plenty of slack for a loaded machine
+    assert(times[4] < 50ms);
+    assert(times.back() >= 190ms);
+    assert(times.back() < 1s);
+    assert(not rate.try_acquire());
+}
+
+
+int main() {
+    test_try_acquire();
+    test_invalid();
+    test_waiters();
+    return 0;
+}
@@ -0,0 +1,68 @@
+#include <f5/threading/queue.hpp>
+#include <boost/asio/io_service.hpp>
+#include <cassert>
+#include <thread>
+#include <vector>
+
+
+void test_overwrite() {
+    boost::asio::io_service ios;
+    f5::boost_asio::ring<int> ring{ios, 2};
+    assert(ring.pop_front(-1) == -1);
+    for (int i{}; i < 3; ++i) ring.push_back([i]() { return i; });
+
+    std::vector<int> seen;
+    boost::asio::spawn(ios, [&](auto yield) {
+        seen.push_back(ring.pop_front(yield));
+        seen.push_back(ring.pop_front(yield));
+    });
+    ios.run();
+    assert((seen == std::vector<int>{1, 2}));
+}
+
+
+void test_suspends() {
+    boost::asio::io_service ios;
+    f5::boost_asio::ring<int> ring{ios, 128};
+    int total{};
+    for (int c{}; c < 4; ++c) {
+        boost::asio::spawn(ios, [&](auto yield) {
+            for (int n{}; n < 25; ++n) total += ring.pop_front(yield);
+        });
+    }
+    std::thread producer{[&]() {
+        for (int n{}; n < 100; ++n) ring.push_back([]() { return 1; });
+    }};
+    ios.run();
+    producer.join();
+    assert(total == 100);
+}
+
+
+/// Overwritten items and those taken without waiting don't leave anything
+/// behind for a suspended consumer to claim
+void test_claims() {
+    boost::asio::io_service ios;
+    f5::boost_asio::ring<int> ring{ios, 10};
+    for (int i{}; i < 1000; ++i) ring.push_back([i]() { return i; });
+    for (int i{990}; i < 995; ++i) assert(ring.pop_front(-1) == i);
+
+    std::vector<int> seen;
+    boost::asio::spawn(ios, [&](auto yield) {
+        for (int n{}; n < 6; ++n) seen.push_back(ring.pop_front(yield));
+    });
+    ios.poll();
+    assert((seen == std::vector<int>{995, 996, 997, 998, 999}));
+    assert(ring.pop_front(-1) == -1);
+    ring.push_back([]() { return 1000; });
+    ios.run();
+    assert(seen.size() == 6u && seen.back() == 1000);
+}
+
+
+int main() {
+    test_overwrite();
+    test_suspends();
+    test_claims();
+    return 0;
+}
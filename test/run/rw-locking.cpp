@@ -0,0 +1,53 @@
+#include <f5/threading/map.hpp>
+#include <f5/threading/set.hpp>
+#include <atomic>
+#include <cassert>
+#include <thread>
+#include <vector>
+
+
+void test_tsmap_rw() {
+    f5::tsmap_rw<int, std::shared_ptr<int>> map;
+    for (int n{}; n < 100; ++n) map.insert_or_assign(n, std::make_shared<int>(n));
+
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> readers;
+    for (int t{}; t < 4; ++t) {
+        readers.emplace_back([&]() {
+            while (not stop) {
+                for (int n{}; n < 100; ++n) {
+                    auto v = map.find(n);
+                    assert(v && *v == n);
+                }
+            }
+        });
+    }
+    for (int n{100}; n < 200; ++n) {
+        map.insert_or_assign(n, std::make_shared<int>(n));
+    }
+    stop = true;
+    for (auto &t : readers) t.join();
+
+    assert(map.size() == 200u);
+    assert(map.alter(1, [](auto &v) { v = std::make_shared<int>(-1); }));
+    assert(*map.find(1) == -1);
+}
+
+
+void test_tsset_rw() {
+    f5::tsset_rw<int> set;
+    assert(set.insert_if_not_found(3));
+    assert(set.insert_if_not_found(1));
+    assert(not set.insert_if_not_found(3));
+    assert(set.size() == 2u);
+
+    int total{};
+    set.for_each([&total](int v) { total += v; });
+    assert(total == 4);
+}
+
+
+int main() {
+    test_tsmap_rw();
+    test_tsset_rw();
+}
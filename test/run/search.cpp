@@ -0,0 +1,82 @@
+#include <f5/threading/map.hpp>
+#include <f5/threading/set.hpp>
+#include <cassert>
+#include <random>
+
+
+void test_branchless_lower_bound() {
+    std::vector<int> v;
+    for (int n{}; n < 300; ++n) {
+        for (int k{-2}; k < 2 * n + 2; ++k) {
+            auto const expected =
+                    std::lower_bound(v.begin(), v.end(), k) - v.begin();
+            assert(f5::branchless_lower_bound(v.data(), v.size(), k)
+                   == std::size_t(expected));
+        }
+        v.push_back(2 * n);
+    }
+}
+
+
+void test_tsmap_index() {
+    f5::tsmap<long, std::shared_ptr<long>> map;
+    std::mt19937 rng{7};
+    std::uniform_int_distribution<long> key{0, 500};
+    std::vector<bool> present(501);
+    for (int n{}; n < 20000; ++n) {
+        auto const k = key(rng);
+        switch (n % 4) {
+        case 0:
+            assert(map.remove(k) == present[k]);
+            present[k] = false;
+            break;
+        case 1:
+            map.insert_or_assign(k, std::make_shared<long>(k));
+            present[k] = true;
+            break;
+        default:
+            assert(bool(map.find(k)) == present[k]);
+        }
+    }
+    map.remove_if([](long k, auto const &) { return k % 3 == 0; });
+    for (long k{}; k <= 500; ++k) {
+        assert(bool(map.find(k)) == (present[k] && k % 3 != 0));
+    }
+}
+
+
+void test_tsset() {
+    f5::tsset<int> set;
+    for (int n{}; n < 100; n += 2) set.insert_if_not_found(n);
+    assert(not set.insert_if_not_found(50));
+    assert(set.insert_if_not_found(51));
+    assert(not set.remove(53));
+    assert(set.remove(51));
+    assert(set.size() == 50u);
+}
+
+
+void test_bool_keys() {
+    f5::tsmap<bool, std::shared_ptr<int>> map;
+    map.insert_or_assign(true, std::make_shared<int>(1));
+    assert(not map.find(false));
+    map.insert_or_assign(false, std::make_shared<int>(0));
+    assert(*map.find(false) == 0);
+    assert(*map.find(true) == 1);
+    assert(map.remove(true));
+    assert(not map.find(true));
+
+    f5::tsset<bool> set;
+    assert(set.insert_if_not_found(true));
+    assert(not set.insert_if_not_found(true));
+    assert(set.insert_if_not_found(false));
+    assert(set.size() == 2u);
+}
+
+
+int main() {
+    test_branchless_lower_bound();
+    test_tsmap_index();
+    test_tsset();
+    test_bool_keys();
+}
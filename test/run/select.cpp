@@ -0,0 +1,131 @@
+#include <f5/threading/channel.hpp>
+#include <f5/threading/select.hpp>
+#include <cassert>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+
+/// A coroutine waiting on several sources is woken by whichever gets an
+/// item
+void test_wakes() {
+    boost::asio::io_service ios;
+    f5::boost_asio::queue<int> q1{ios}, q2{ios};
+    f5::boost_asio::channel<int> c{ios, 4};
+    std::vector<std::pair<std::size_t, int>> seen;
+    // Keeps the IO service running until the item from the other thread
+    auto work = std::make_unique<boost::asio::io_service::work>(ios);
+    boost::asio::spawn(ios, [&](auto yield) {
+        for (int n{}; n < 3; ++n) {
+            seen.push_back(f5::boost_asio::consume_any(yield, q1, q2, c));
+        }
+        work.reset();
+    });
+    boost::asio::spawn(ios, [&](auto yield) {
+        q2.produce(20);
+        boost::asio::steady_timer timer{ios};
+        timer.expires_after(std::chrono::milliseconds{5});
+        timer.async_wait(yield);
+        c.produce(30, yield);
+    });
+    std::thread producer{[&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds{20});
+        q1.produce(10);
+    }};
+    ios.run();
+    producer.join();
+    assert((seen
+            == std::vector<std::pair<std::size_t, int>>{
+                    {1, 20}, {2, 30}, {0, 10}}));
+    assert(q1.empty() && q2.empty() && c.empty());
+}
+
+
+/// A busy source doesn't stop the others from being served
+void test_fairness() {
+    boost::asio::io_service ios;
+    f5::boost_asio::queue<int> hot{ios}, cold{ios};
+    for (int n{}; n < 100; ++n) hot.produce(n);
+    for (int n{}; n < 3; ++n) cold.produce(n);
+    std::size_t from_cold{};
+    boost::asio::spawn(ios, [&](auto yield) {
+        f5::boost_asio::selector<
+                f5::boost_asio::queue<int>, f5::boost_asio::queue<int>>
+                select{hot, cold};
+        for (int n{}; n < 6; ++n) from_cold += select.consume(yield).first;
+    });
+    ios.run();
+    assert(from_cold == 3);
+}
+
+
+/// Nothing arrives before the timeout
+void test_timeout() {
+    boost::asio::io_service ios;
+    f5::boost_asio::queue<int> q1{ios}, q2{ios};
+    bool timed_out{}, got{};
+    boost::asio::spawn(ios, [&](auto yield) {
+        timed_out = not f5::boost_asio::consume_any(
+                yield, std::chrono::milliseconds{10}, q1, q2);
+        q2.produce(2);
+        auto const v = f5::boost_asio::consume_any(
+                yield, std::chrono::seconds{10}, q1, q2);
+        got = v && v->first == 1 && v->second == 2;
+    });
+    auto const start = std::chrono::steady_clock::now();
+    ios.run();
+    assert(timed_out);
+    assert(got);
+    assert(std::chrono::steady_clock::now() - start
+           < std::chrono::seconds{5});
+}
+
+
+/// Closing every source wakes a coroutine waiting on them, which then
+/// throws. Items already produced are still consumed first
+void test_closed() {
+    boost::asio::io_service ios;
+    f5::boost_asio::queue<int> q{ios};
+    f5::boost_asio::channel<int> c{ios, 4};
+    std::vector<int> seen;
+    bool aborted{}, timed_aborted{};
+    boost::asio::spawn(ios, [&](auto yield) {
+        try {
+            while (true) {
+                seen.push_back(f5::boost_asio::consume_any(yield, q, c).second);
+            }
+        } catch (boost::system::system_error &) { aborted = true; }
+        try {
+            f5::boost_asio::consume_any(
+                    yield, std::chrono::seconds{10}, q, c);
+        } catch (boost::system::system_error &) { timed_aborted = true; }
+    });
+    boost::asio::spawn(ios, [&](auto yield) {
+        q.produce(1);
+        boost::asio::steady_timer timer{ios};
+        timer.expires_after(std::chrono::milliseconds{5});
+        timer.async_wait(yield);
+        c.produce(2, yield);
+        c.close();
+        timer.expires_after(std::chrono::milliseconds{5});
+        timer.async_wait(yield);
+        q.close();
+    });
+    auto const start = std::chrono::steady_clock::now();
+    ios.run();
+    assert(aborted);
+    assert(timed_aborted);
+    assert((seen == std::vector<int>{1, 2}));
+    assert(std::chrono::steady_clock::now() - start
+           < std::chrono::seconds{5});
+}
+
+
+int main() {
+    test_wakes();
+    test_fairness();
+    test_timeout();
+    test_closed();
+    return 0;
+}
@@ -0,0 +1,139 @@
+#include <f5/threading/slots.hpp>
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+/// Count allocations so that the channel can be checked for them
+std::atomic<std::size_t> allocations{};
+void *operator new(std::size_t s) {
+    ++allocations;
+    if (auto p = std::malloc(s)) return p;
+    throw std::bad_alloc{};
+}
+[[gnu::noinline]] void operator delete(void *p) noexcept { std::free(p); }
+[[gnu::noinline]] void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+
+/// Items arrive in order and producers wait for a free slot
+void test_order() {
+    boost::asio::io_service ios;
+    f5::boost_asio::slot_channel<std::string> channel{ios, 2};
+    std::vector<std::string> seen;
+    boost::asio::spawn(ios, [&](auto yield) {
+        for (char c{'a'}; c < 'f'; ++c) {
+            channel.produce(std::string(1, c), yield);
+        }
+    });
+    boost::asio::spawn(ios, [&](auto yield) {
+        for (int n{}; n < 5; ++n) seen.push_back(channel.consume(yield));
+    });
+    ios.run();
+    assert((seen == std::vector<std::string>{"a", "b", "c", "d", "e"}));
+}
+
+
+/// The only allocations made while items pass through the channel are
+/// Asio's own, when it posts the handlers of the coroutines being resumed.
+/// With a single slot the producer and consumer take turns, so every item
+/// suspends and resumes each of them once
+void test_no_allocation() {
+    std::size_t per_resume{};
+    {
+        boost::asio::io_service ios;
+        boost::asio::spawn(ios, [&](auto yield) {
+            boost::asio::post(yield);
+            auto const before = allocations.load();
+            for (int n{}; n < 1000; ++n) boost::asio::post(yield);
+            per_resume = (allocations - before) / 1000;
+        });
+        ios.run();
+    }
+
+    boost::asio::io_service ios;
+    f5::boost_asio::slot_channel<int> channel{ios, 1};
+    std::size_t before{}, after{};
+    int total{};
+    boost::asio::spawn(ios, [&](auto yield) {
+        // Let both coroutines reach the channel before counting
+        channel.produce(0, yield);
+        channel.produce(0, yield);
+        before = allocations;
+        for (int n{}; n < 1000; ++n) channel.produce(n, yield);
+    });
+    boost::asio::spawn(ios, [&](auto yield) {
+        channel.consume(yield);
+        channel.consume(yield);
+        for (int n{}; n < 1000; ++n) total += channel.consume(yield);
+        after = allocations;
+    });
+    ios.run();
+    assert(total == 499500);
+    assert(after - before <= 2 * 1000 * per_resume);
+}
+
+
+/// Many producers and consumers on many threads, with the producers
+/// waiting for everything to be consumed
+void test_threads() {
+    boost::asio::io_service ios;
+    f5::boost_asio::slot_channel<int> channel{ios, 8};
+    std::atomic<int> total{}, drained{};
+    for (int p{}; p < 4; ++p) {
+        boost::asio::spawn(ios, [&](auto yield) {
+            for (int n{}; n < 1000; ++n) channel.produce(1, yield);
+            channel.wait_for_all_outstanding(yield);
+            ++drained;
+        });
+    }
+    for (int c{}; c < 4; ++c) {
+        boost::asio::spawn(ios, [&](auto yield) {
+            for (int n{}; n < 1000; ++n) total += channel.consume(yield);
+        });
+    }
+    std::vector<std::thread> threads;
+    for (int t{}; t < 4; ++t) threads.emplace_back([&ios]() { ios.run(); });
+    for (auto &t : threads) t.join();
+    assert(total == 4000);
+    assert(drained == 4);
+}
+
+
+/// Closing resumes the waiting coroutines with an error, but what is
+/// already in the channel can still be consumed
+void test_close() {
+    boost::asio::io_service ios;
+    f5::boost_asio::slot_channel<int> channel{ios, 1};
+    int aborted{}, consumed{};
+    boost::asio::spawn(ios, [&](auto yield) {
+        channel.produce(1, yield);
+        try {
+            channel.produce(2, yield);
+        } catch (boost::system::system_error &) { ++aborted; }
+    });
+    boost::asio::spawn(ios, [&](auto) { channel.close(); });
+    boost::asio::spawn(ios, [&](auto yield) {
+        consumed = channel.consume(yield);
+        try {
+            channel.consume(yield);
+        } catch (boost::system::system_error &) { ++aborted; }
+    });
+    ios.run();
+    assert(aborted == 2);
+    assert(consumed == 1);
+}
+
+
+int main() {
+    test_order();
+    test_no_allocation();
+    test_threads();
+    test_close();
+    return 0;
+}
@@ -0,0 +1,165 @@
+#include <f5/threading/transform.hpp>
+#include <atomic>
+#include <cassert>
+#include <future>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+using input_type = f5::boost_asio::channel<int>;
+using output_type = f5::boost_asio::channel<std::string>;
+
+
+/// Feed the numbers into the input, close it and then collect whatever
+/// comes out of the output until that is closed
+std::vector<std::string> run(
+        f5::boost_asio::reactor_pool &pool,
+        input_type &input,
+        output_type &output,
+        int count) {
+    std::promise<std::vector<std::string>> done;
+    boost::asio::spawn(pool.get_io_service(), [&](auto yield) {
+        std::vector<int> items(count);
+        std::iota(items.begin(), items.end(), 0);
+        input.produce_many(std::move(items), yield);
+        input.close();
+    });
+    boost::asio::spawn(pool.get_io_service(), [&](auto yield) {
+        std::vector<std::string> seen;
+        try {
+            while (true) {
+                for (auto &s : output.consume_many(yield, 16)) {
+                    seen.push_back(std::move(s));
+                }
+            }
+        } catch (boost::system::system_error &) {
+            // Closed once the stage has finished
+        }
+        done.set_value(std::move(seen));
+    });
+    return done.get_future().get();
+}
+
+
+/// Results come out in order even though the work is done in parallel
+void test_ordered() {
+    f5::boost_asio::reactor_pool pool{[]() { return false; }, 4};
+    input_type input{pool.get_io_service(), 8};
+    output_type output{pool.get_io_service(), 8};
+    f5::boost_asio::transform<input_type, output_type> stage{
+            pool,
+            input,
+            output,
+            [](int n) { return std::to_string(n * 2); },
+            4,
+            f5::boost_asio::ordering::preserved,
+            3};
+    auto const seen = run(pool, input, output, 1000);
+    assert(seen.size() == 1000u);
+    for (int n{}; n < 1000; ++n) assert(seen[n] == std::to_string(n * 2));
+}
+
+
+/// Without ordering every result still arrives once
+void test_unordered() {
+    f5::boost_asio::reactor_pool pool{[]() { return false; }, 4};
+    input_type input{pool.get_io_service(), 8};
+    output_type output{pool.get_io_service(), 8};
+    f5::boost_asio::transform<input_type, output_type> stage{
+            pool,
+            input,
+            output,
+            [](int n) { return std::to_string(n); },
+            3,
+            f5::boost_asio::ordering::unordered,
+            5};
+    auto const seen = run(pool, input, output, 1000);
+    assert(seen.size() == 1000u);
+    long total{};
+    for (auto const &s : seen) total += std::stol(s);
+    assert(total == 499500);
+}
+
+
+/// An exception from the function ends the stage and comes out of `wait`
+void test_failure() {
+    f5::boost_asio::reactor_pool pool{[]() { return false; }, 2};
+    input_type input{pool.get_io_service(), 8};
+    output_type output{pool.get_io_service(), 8};
+    f5::boost_asio::transform<input_type, output_type> stage{
+            pool, input, output,
+            [](int n) {
+                if (n == 50) throw std::runtime_error("Bad item");
+                return std::to_string(n);
+            },
+            2};
+    std::promise<bool> failed;
+    boost::asio::spawn(pool.get_io_service(), [&](auto yield) {
+        try {
+            for (int n{}; n < 100; ++n) input.produce(n, yield);
+        } catch (...) {
+            // The input is closed when the function fails
+        }
+    });
+    boost::asio::spawn(pool.get_io_service(), [&](auto yield) {
+        try {
+            while (true) output.consume(yield);
+        } catch (...) {}
+        try {
+            stage.wait(yield);
+            failed.set_value(false);
+        } catch (std::runtime_error &) { failed.set_value(true); }
+    });
+    assert(failed.get_future().get());
+}
+
+
+/// A `system_error` from the function is a failure too, and not mistaken
+/// for one of the channels being closed
+void test_system_error_failure() {
+    f5::boost_asio::reactor_pool pool{[]() { return false; }, 2};
+    input_type input{pool.get_io_service(), 8};
+    output_type output{pool.get_io_service(), 8};
+    f5::boost_asio::transform<input_type, output_type> stage{
+            pool, input, output,
+            [](int n) {
+                if (n == 50) {
+                    throw boost::system::system_error{
+                            boost::asio::error::connection_reset};
+                }
+                return std::to_string(n);
+            },
+            2};
+    std::promise<bool> failed;
+    boost::asio::spawn(pool.get_io_service(), [&](auto yield) {
+        try {
+            for (int n{}; n < 100; ++n) input.produce(n, yield);
+        } catch (...) {
+            // The input is closed when the function fails
+        }
+    });
+    boost::asio::spawn(pool.get_io_service(), [&](auto yield) {
+        try {
+            while (true) output.consume(yield);
+        } catch (...) {}
+        try {
+            stage.wait(yield);
+            failed.set_value(false);
+        } catch (boost::system::system_error &e) {
+            failed.set_value(
+                    e.code() == boost::asio::error::connection_reset);
+        }
+    });
+    assert(failed.get_future().get());
+}
+
+
+int main() {
+    test_ordered();
+    test_unordered();
+    test_failure();
+    test_system_error_failure();
+    return 0;
+}
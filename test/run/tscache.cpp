@@ -0,0 +1,93 @@
+#include <f5/threading/cache.hpp>
+#include <cassert>
+#include <string>
+#include <vector>
+
+
+/// A clock that only moves when the test says so
+struct test_clock {
+    using duration = std::chrono::seconds;
+    using rep = duration::rep;
+    using period = duration::period;
+    using time_point = std::chrono::time_point<test_clock>;
+    static constexpr bool is_steady = true;
+    static time_point current;
+    static time_point now() { return current; }
+};
+test_clock::time_point test_clock::current{};
+
+
+void test_lru() {
+    std::vector<int> evicted;
+    f5::tscache<int, std::shared_ptr<std::string>> cache{
+            2, {}, [&evicted](int k, auto &) { evicted.push_back(k); }};
+
+    cache.insert_or_assign(1, std::make_shared<std::string>("one"));
+    cache.insert_or_assign(2, std::make_shared<std::string>("two"));
+    assert(cache.find(1) && *cache.find(1) == "one");
+    cache.insert_or_assign(3, std::make_shared<std::string>("three"));
+
+    assert(evicted == std::vector<int>{2});
+    assert(cache.find(2) == nullptr);
+    assert(cache.find(3) && *cache.find(3) == "three");
+    assert(cache.size() == 2u);
+    cache.insert_or_assign(3, std::make_shared<std::string>("3"));
+
+    // Writes are counted as well as look ups
+    auto const stats = cache.stats();
+    assert(stats.hits == 5u);
+    assert(stats.misses == 4u);
+    assert(stats.evictions == 1u);
+}
+
+
+void test_ttl() {
+    std::vector<int> evicted;
+    f5::tscache<
+            int, std::shared_ptr<std::string>,
+            f5::container_by_value_policy<std::shared_ptr<std::string>>,
+            test_clock>
+            cache{
+            0, std::chrono::seconds{10},
+            [&evicted](int k, auto &) { evicted.push_back(k); }};
+
+    cache.add_if_not_found(
+            1, []() { return std::make_shared<std::string>("one"); });
+    test_clock::current += std::chrono::seconds{5};
+    cache.add_if_not_found(
+            2, []() { return std::make_shared<std::string>("two"); });
+    assert(cache.find(1) && *cache.find(1) == "one");
+
+    test_clock::current += std::chrono::seconds{6};
+    assert(cache.find(1) == nullptr);
+    assert(evicted == std::vector<int>{1});
+    assert(cache.find(2) && *cache.find(2) == "two");
+
+    test_clock::current += std::chrono::seconds{6};
+    assert(cache.expire() == 1u);
+    assert(evicted == (std::vector<int>{1, 2}));
+    assert(cache.stats().expirations == 2u);
+    assert(cache.size() == 0u);
+}
+
+
+/// A value that has been handed out stays alive after another insert
+/// evicts its entry
+void test_held_after_eviction() {
+    f5::tscache<int, std::shared_ptr<std::string>> cache{1};
+    auto const one = cache.insert_or_assign(
+            1, std::make_shared<std::string>("one"));
+    auto const found = cache.find(1);
+    cache.add_if_not_found(
+            2, []() { return std::make_shared<std::string>("two"); });
+    assert(cache.find(1) == nullptr);
+    assert(*one == "one" && *found == "one");
+    assert(one.use_count() == 2);
+}
+
+
+int main() {
+    test_lru();
+    test_ttl();
+    test_held_after_eviction();
+}
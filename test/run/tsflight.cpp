@@ -0,0 +1,85 @@
+#include <f5/threading/flight.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+
+void test_blocking() {
+    f5::tsflight<int, std::shared_ptr<int>> map;
+    std::atomic<int> runs{};
+    std::vector<std::thread> threads;
+    for (int t{}; t < 8; ++t) {
+        threads.emplace_back([&]() {
+            auto v = map.get_or_compute(1, [&]() {
+                ++runs;
+                std::this_thread::sleep_for(std::chrono::milliseconds{50});
+                return std::make_shared<int>(42);
+            });
+            assert(v && *v == 42);
+        });
+    }
+    for (auto &t : threads) t.join();
+    assert(runs == 1);
+    assert(map.map().find(1) && *map.map().find(1) == 42);
+}
+
+
+void test_failure() {
+    f5::tsflight<int, std::shared_ptr<int>> map;
+    std::atomic<int> failures{};
+    std::vector<std::thread> threads;
+    for (int t{}; t < 4; ++t) {
+        threads.emplace_back([&]() {
+            try {
+                map.get_or_compute(1, []() -> std::shared_ptr<int> {
+                    std::this_thread::sleep_for(
+                            std::chrono::milliseconds{50});
+                    throw std::runtime_error("No value");
+                });
+            } catch (std::runtime_error &) { ++failures; }
+        });
+    }
+    for (auto &t : threads) t.join();
+    assert(failures == 4);
+    assert(map.map().find(1) == nullptr);
+    auto v = map.get_or_compute(1, []() { return std::make_shared<int>(3); });
+    assert(*v == 3);
+}
+
+
+void test_coroutines() {
+    boost::asio::io_service ios;
+    f5::tsflight<int, std::shared_ptr<int>> map;
+    int runs{}, done{};
+    for (int c{}; c < 4; ++c) {
+        boost::asio::spawn(ios, [&](auto yield) {
+            auto v = map.get_or_compute(
+                    1,
+                    [&]() {
+                        ++runs;
+                        boost::asio::steady_timer timer{ios};
+                        timer.expires_from_now(std::chrono::milliseconds{20});
+                        timer.async_wait(yield);
+                        return std::make_shared<int>(7);
+                    },
+                    yield);
+            assert(v && *v == 7);
+            ++done;
+        });
+    }
+    ios.run();
+    assert(runs == 1);
+    assert(done == 4);
+}
+
+
+int main() {
+    test_blocking();
+    test_failure();
+    test_coroutines();
+}
@@ -0,0 +1,102 @@
+#include <f5/threading/hashmap.hpp>
+#include <cassert>
+#include <map>
+#include <random>
+#include <string>
+
+
+void test_unique_ptr() {
+    f5::tshashmap<int, std::unique_ptr<std::string>> map;
+
+    map.insert_or_assign(1, std::make_unique<std::string>("one"));
+    map.insert_or_assign(3, std::make_unique<std::string>("three"));
+    map.emplace_if_not_found(2, std::make_unique<std::string>("two"));
+    map.emplace_if_not_found(2, std::make_unique<std::string>("2"));
+
+    assert(map.find(1) && *map.find(1) == "one");
+    assert(map.find(2) && *map.find(2) == "two");
+    assert(map.find(3) && *map.find(3) == "three");
+    assert(map.find(4) == nullptr);
+
+    assert(map.alter(3, [](auto &v) { *v = "3"; }));
+    assert(*map.find(3) == "3");
+    assert(not map.remove(4));
+    assert(map.remove(1));
+    assert(map.find(1) == nullptr);
+    assert(map.size() == 2u);
+}
+
+
+void test_weak_ptr() {
+    f5::tshashmap<std::string, std::weak_ptr<int>> map;
+    auto one = std::make_shared<int>(1);
+    map.add_if_not_found("one", [&]() { return one; });
+    assert(map.find("one") == one);
+    one.reset();
+    assert(map.find("one") == nullptr);
+}
+
+
+/// Assigning to a key that is already there must not grow the table, even
+/// when the table is as full as it is allowed to get
+void test_assign_does_not_grow() {
+    f5::tshashmap<int, std::shared_ptr<int>> map;
+    for (int n{}; n < 12; ++n) {
+        map.insert_or_assign(n, std::make_shared<int>(n));
+    }
+    auto const where = [&map](int k) {
+        std::shared_ptr<int> const *p = nullptr;
+        map.alter(k, [&p](auto &v) { p = &v; });
+        return p;
+    };
+    auto const before = where(5);
+    map.insert_or_assign(5, std::make_shared<int>(50));
+    map.insert_or_assign_if(
+            5, [](auto const &) { return true; },
+            []() { return std::make_shared<int>(500); });
+    assert(where(5) == before);
+    assert(*map.find(5) == 500);
+    map.insert_or_assign(12, std::make_shared<int>(12));
+    assert(map.size() == 13u);
+    for (int n{}; n < 13; ++n) assert(map.find(n));
+}
+
+
+void test_against_std_map() {
+    f5::tshashmap<int, std::shared_ptr<int>> map;
+    std::map<int, int> check;
+    std::mt19937 rng{42};
+    std::uniform_int_distribution<int> key{0, 2000};
+    for (int n{}; n < 50000; ++n) {
+        auto const k = key(rng);
+        if (n % 3) {
+            map.insert_or_assign(k, std::make_shared<int>(n));
+            check[k] = n;
+        } else {
+            assert(map.remove(k) == (check.erase(k) == 1u));
+        }
+    }
+    assert(map.size() == check.size());
+    for (auto const &[k, v] : check) assert(*map.find(k) == v);
+
+    auto const left = map.remove_if([](int k, auto const &) { return k % 2; });
+    std::size_t even{};
+    for (auto const &kv : check) even += (kv.first % 2) == 0;
+    assert(left == even);
+    std::size_t seen{};
+    map.for_each([&seen](int k, auto const &) {
+        assert(k % 2 == 0);
+        ++seen;
+    });
+    assert(seen == even);
+    assert(map.clear() == even);
+    assert(map.find(0) == nullptr);
+}
+
+
+int main() {
+    test_unique_ptr();
+    test_weak_ptr();
+    test_assign_does_not_grow();
+    test_against_std_map();
+}
@@ -0,0 +1,100 @@
+#include <f5/threading/map.hpp>
+#include <cassert>
+#include <string>
+#include <vector>
+
+
+void test_insert_range() {
+    f5::tsmap<int, std::shared_ptr<std::string>> map;
+    map.insert_or_assign(2, std::make_shared<std::string>("two"));
+
+    std::vector<std::pair<int, std::shared_ptr<std::string>>> batch{
+            {3, std::make_shared<std::string>("three")},
+            {1, std::make_shared<std::string>("one")},
+            {2, std::make_shared<std::string>("2")},
+            {1, std::make_shared<std::string>("1")}};
+    assert(map.insert_range(batch) == 2u);
+    assert(batch[0].second && *batch[0].second == "three");
+
+    assert(map.size() == 3u);
+    assert(*map.find(1) == "one");
+    assert(*map.find(2) == "two");
+    assert(*map.find(3) == "three");
+}
+
+
+void test_assign_range() {
+    f5::tsmap<int, std::unique_ptr<std::string>> map;
+    map.insert_or_assign(2, std::make_unique<std::string>("two"));
+    map.insert_or_assign(5, std::make_unique<std::string>("five"));
+
+    std::vector<std::pair<int, std::unique_ptr<std::string>>> batch;
+    batch.emplace_back(4, std::make_unique<std::string>("four"));
+    batch.emplace_back(1, std::make_unique<std::string>("one"));
+    batch.emplace_back(2, std::make_unique<std::string>("2"));
+    batch.emplace_back(1, std::make_unique<std::string>("1"));
+    assert(map.assign_range(std::move(batch)) == 2u);
+
+    assert(map.size() == 4u);
+    assert(*map.find(1) == "1");
+    assert(*map.find(2) == "2");
+    assert(*map.find(4) == "four");
+    assert(*map.find(5) == "five");
+
+    std::vector<int> keys{0, 1, 3, 4, 6};
+    std::vector<std::string *> found;
+    map.find_many(keys.begin(), keys.end(), std::back_inserter(found));
+    assert(found.size() == 5u);
+    assert(found[0] == nullptr);
+    assert(found[1] && *found[1] == "1");
+    assert(found[2] == nullptr);
+    assert(found[3] && *found[3] == "four");
+    assert(found[4] == nullptr);
+}
+
+
+void test_sharded() {
+    f5::tsmap_sharded<int, std::shared_ptr<int>> map;
+    std::vector<std::pair<int, std::shared_ptr<int>>> batch;
+    for (int n{}; n < 1000; ++n) {
+        batch.emplace_back(n, std::make_shared<int>(n));
+    }
+    assert(map.assign_range(batch) == 1000u);
+    assert(map.insert_range(batch) == 0u);
+    assert(map.size() == 1000u);
+    assert(*map.find(999) == 999);
+
+    std::vector<int> keys;
+    for (int n{-5}; n < 1010; n += 5) keys.push_back(n);
+    std::vector<std::shared_ptr<int>> found;
+    map.find_many(keys.begin(), keys.end(), std::back_inserter(found));
+    assert(found.size() == keys.size());
+    for (std::size_t i{}; i < keys.size(); ++i) {
+        if (keys[i] < 0 || keys[i] >= 1000) {
+            assert(found[i] == nullptr);
+        } else {
+            assert(found[i] && *found[i] == keys[i]);
+        }
+    }
+}
+
+
+void test_find_many_strings() {
+    f5::tsmap<std::string, std::shared_ptr<int>> map;
+    map.insert_or_assign("b", std::make_shared<int>(2));
+    map.insert_or_assign("d", std::make_shared<int>(4));
+    std::vector<std::string> keys{"a", "b", "c", "d", "e"};
+    std::vector<std::shared_ptr<int>> found;
+    map.find_many(keys.begin(), keys.end(), std::back_inserter(found));
+    assert(found.size() == 5u);
+    assert(not found[0] && not found[2] && not found[4]);
+    assert(*found[1] == 2 && *found[3] == 4);
+}
+
+
+int main() {
+    test_insert_range();
+    test_assign_range();
+    test_sharded();
+    test_find_many_strings();
+}
@@ -0,0 +1,61 @@
+#include <f5/threading/locked.hpp>
+#include <cassert>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+struct stats {
+    std::size_t requests = {}, bytes = {};
+};
+
+
+void test_alter_in_parallel() {
+    f5::tsmap_locked<int, stats> map;
+    for (int k{}; k < 4; ++k) map.emplace_if_not_found(k);
+
+    std::vector<std::thread> threads;
+    for (int t{}; t < 8; ++t) {
+        threads.emplace_back([&map, t]() {
+            for (int n{}; n < 10000; ++n) {
+                map.alter(t % 4, [](stats &s) {
+                    ++s.requests;
+                    s.bytes += 10;
+                });
+            }
+        });
+    }
+    for (auto &t : threads) t.join();
+
+    std::size_t total{};
+    map.for_each([&total](int, stats const &s) {
+        assert(s.bytes == s.requests * 10);
+        total += s.requests;
+    });
+    assert(total == 80000u);
+    assert(map.alter(
+            0, [](stats const &s) { assert(s.requests == 20000u); }));
+}
+
+
+void test_unique_ptr() {
+    f5::tsmap_locked<int, std::unique_ptr<std::string>> map;
+    map.insert_or_assign(1, std::make_unique<std::string>("one"));
+    map.insert_or_assign(2, std::make_unique<std::string>("two"));
+    map.insert_or_assign(2, std::make_unique<std::string>("2"));
+    assert(map.find(1) && *map.find(1) == "one");
+    assert(map.find(2) && *map.find(2) == "2");
+    assert(map.find(3) == nullptr);
+
+    assert(not map.remove(3));
+    assert(map.size() == 2u);
+    assert(map.remove(1));
+    assert(map.find(1) == nullptr);
+    assert(map.remove_if([](int, auto const &v) { return *v == "2"; }) == 0u);
+}
+
+
+int main() {
+    test_alter_in_parallel();
+    test_unique_ptr();
+}
@@ -0,0 +1,87 @@
+#include <f5/threading/rcu.hpp>
+#include <atomic>
+#include <cassert>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+void test_single_thread() {
+    f5::tsmap_rcu<int, std::shared_ptr<std::string>> map;
+
+    map.insert_or_assign(1, std::make_shared<std::string>("one"));
+    map.insert_or_assign(3, std::make_shared<std::string>("three"));
+    map.emplace_if_not_found(2, std::make_shared<std::string>("two"));
+    map.emplace_if_not_found(2, std::make_shared<std::string>("2"));
+
+    assert(map.find(1) && *map.find(1) == "one");
+    assert(map.find(2) && *map.find(2) == "two");
+    assert(map.find(3) && *map.find(3) == "three");
+    assert(map.find(4) == nullptr);
+
+    auto before = map.snapshot();
+    assert(map.alter(
+            2, [](auto &v) { v = std::make_shared<std::string>("2"); }));
+    assert(*map.find(2) == "2");
+    assert(before->size() == 3u && *(*before)[1].second == "two");
+
+    assert(not map.remove(4));
+    assert(map.remove(1));
+    assert(map.find(1) == nullptr);
+    assert(map.remove_if([](int k, auto const &) { return k == 2; }) == 1u);
+    assert(map.clear() == 1u);
+    assert(map.size() == 0u);
+}
+
+
+/// Writes that don't change anything don't publish a new snapshot
+void test_no_copy() {
+    f5::tsmap_rcu<int, std::shared_ptr<std::string>> map;
+    map.insert_or_assign(1, std::make_shared<std::string>("one"));
+    auto const before = map.snapshot();
+    assert(not map.alter(2, [](auto &) { assert(false); }));
+    assert(map.alter(1, [](auto &v) { *v = "1"; }));
+    map.add_if_not_found(
+            1, []() { return std::make_shared<std::string>("x"); },
+            [](auto &) {});
+    assert(map.snapshot() == before);
+    assert(*map.find(1) == "1");
+    map.add_if_not_found(
+            1, []() { return std::make_shared<std::string>("x"); },
+            [](auto &v) { v = std::make_shared<std::string>("uno"); });
+    assert(map.snapshot() != before);
+    assert(*map.find(1) == "uno");
+}
+
+
+void test_concurrent_readers() {
+    f5::tsmap_rcu<int, std::shared_ptr<int>> map;
+    map.insert_or_assign(0, std::make_shared<int>(0));
+
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> readers;
+    for (int t{}; t < 4; ++t) {
+        readers.emplace_back([&]() {
+            while (not stop) {
+                auto v = map.find(0);
+                assert(v && *v >= 0);
+                map.for_each([](int k, auto const &v) { assert(*v >= k); });
+            }
+        });
+    }
+    for (int n{1}; n < 500; ++n) {
+        map.insert_or_assign(n, std::make_shared<int>(n));
+        map.insert_or_assign(0, std::make_shared<int>(n));
+    }
+    stop = true;
+    for (auto &t : readers) t.join();
+    assert(map.size() == 500u);
+    assert(*map.find(0) == 499);
+}
+
+
+int main() {
+    test_single_thread();
+    test_no_copy();
+    test_concurrent_readers();
+}
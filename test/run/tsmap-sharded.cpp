@@ -0,0 +1,110 @@
+#include <f5/threading/map.hpp>
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+
+void test_single_keys() {
+    f5::tsmap_sharded<int, std::unique_ptr<std::string>> map;
+
+    map.insert_or_assign(1, std::make_unique<std::string>("one"));
+    map.insert_or_assign(3, std::make_unique<std::string>("three"));
+    map.emplace_if_not_found(2, std::make_unique<std::string>("two"));
+    map.emplace_if_not_found(2, std::make_unique<std::string>("2"));
+
+    assert(map.find(1) && *map.find(1) == "one");
+    assert(map.find(2) && *map.find(2) == "two");
+    assert(map.find(3) && *map.find(3) == "three");
+    assert(map.find(4) == nullptr);
+    assert(map.size() == 3u);
+
+    assert(map.alter(3, [](auto &v) { *v = "3"; }));
+    assert(*map.find(3) == "3");
+    assert(not map.alter(4, [](auto &) {}));
+}
+
+
+void test_all_shards() {
+    f5::tsmap_sharded<int, std::shared_ptr<int>> map;
+    std::vector<std::thread> threads;
+    for (int t{}; t < 4; ++t) {
+        threads.emplace_back([&map, t]() {
+            for (int n{}; n < 250; ++n) {
+                auto const k = t * 250 + n;
+                map.add_if_not_found(
+                        k, [k]() { return std::make_shared<int>(k); });
+            }
+        });
+    }
+    for (auto &t : threads) t.join();
+    assert(map.size() == 1000u);
+
+    std::size_t count{};
+    map.for_each([&count](int k, auto const &v) {
+        assert(*v == k);
+        ++count;
+    });
+    assert(count == 1000u);
+
+    assert(map.remove_if([](int k, auto const &) { return k % 2; }) == 500u);
+    assert(map.find(1) == nullptr);
+    assert(map.find(2) && *map.find(2) == 2);
+
+    assert(map.clear() == 500u);
+    assert(map.size() == 0u);
+}
+
+
+/// Integer keys that are all multiples of the shard count must still be
+/// spread over every shard
+void test_strided_keys() {
+    using map_type = f5::tsmap_sharded<long, std::shared_ptr<int>>;
+    std::array<std::size_t, map_type::shard_count> counts{};
+    for (long n{}; n < 1000; ++n) ++counts[map_type::shard_of(n * 16)];
+    for (auto c : counts) assert(c > 0u);
+    assert(*std::max_element(counts.begin(), counts.end()) < 125u);
+}
+
+
+/// A transparent hasher for strings
+struct string_hash {
+    using is_transparent = void;
+    std::size_t operator()(std::string_view s) const {
+        return std::hash<std::string_view>{}(s);
+    }
+};
+
+
+/// Looking up with a different type must choose the same shard
+void test_lookup_types() {
+    f5::tsmap_sharded<std::string, std::shared_ptr<int>> map;
+    f5::tsmap_sharded<
+            std::string, std::shared_ptr<int>,
+            f5::container_default_policy<std::shared_ptr<int>>::type, 16,
+            std::mutex, string_hash>
+            transparent;
+    for (int n{}; n < 100; ++n) {
+        auto const k = "key " + std::to_string(n);
+        map.insert_or_assign(k, std::make_shared<int>(n));
+        transparent.insert_or_assign(k, std::make_shared<int>(n));
+        // Converted to the key type
+        assert(map.shard_of(k) == map.shard_of(k.c_str()));
+        // Hashed directly
+        assert(transparent.shard_of(k)
+               == transparent.shard_of(std::string_view{k}));
+    }
+    assert(*map.find("key 42") == 42);
+    assert(*transparent.find(std::string_view{"key 42"}) == 42);
+}
+
+
+int main() {
+    test_single_keys();
+    test_all_shards();
+    test_strided_keys();
+    test_lookup_types();
+}
@@ -0,0 +1,54 @@
+#include <f5/threading/ring.hpp>
+#include <cassert>
+#include <iterator>
+#include <string>
+#include <vector>
+
+
+void test_push_and_pop_n() {
+    f5::tsring<std::string> ring(4);
+    std::vector<std::string> in{"a", "b", "c"};
+    assert(ring.push_back_n(in) == 1u);
+    assert(in[0] == "a");
+    assert(ring.push_back_n(std::vector<std::string>{"d", "e"}) == 0u);
+
+    std::vector<std::string> out;
+    assert(ring.pop_front_n(std::back_inserter(out), 3) == 3u);
+    assert((out == std::vector<std::string>{"b", "c", "d"}));
+    assert(ring.pop_front_n(std::back_inserter(out), 3) == 1u);
+    assert(out.back() == "e");
+    assert(ring.pop_front_n(std::back_inserter(out), 3) == 0u);
+}
+
+
+void test_drain_wrapped() {
+    f5::tsring<int> ring(4);
+    for (int i{}; i < 6; ++i) ring.push_back([i]() { return i; });
+    std::vector<int> seen;
+    std::size_t runs{};
+    assert(ring.drain([&](int *b, int *e) {
+        ++runs;
+        seen.insert(seen.end(), b, e);
+    }) == 4u);
+    assert(runs == 2u);
+    assert((seen == std::vector<int>{2, 3, 4, 5}));
+    assert(ring.drain([](int *, int *) { assert(false); }) == 0u);
+    assert(ring.pop_front(-1) == -1);
+}
+
+
+void test_lockfree() {
+    f5::tsring_mpmc<int> ring(3);
+    ring.push_back_n(std::vector<int>{1, 2, 3, 4});
+    std::vector<int> out;
+    assert(ring.pop_front_n(std::back_inserter(out), 10) == 3u);
+    assert((out == std::vector<int>{2, 3, 4}));
+}
+
+
+int main() {
+    test_push_and_pop_n();
+    test_drain_wrapped();
+    test_lockfree();
+    return 0;
+}
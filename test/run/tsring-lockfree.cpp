@@ -0,0 +1,159 @@
+#include <f5/threading/ring.hpp>
+#include <atomic>
+#include <cassert>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+void test_overwrite() {
+    f5::tsring_spsc<int> ring(3);
+    assert(ring.pop_front(-1) == -1);
+    assert(ring.push_back([]() { return 1; }) == 2u);
+    ring.push_back([]() { return 2; });
+    ring.push_back([]() { return 3; });
+    assert(ring.push_back([]() { return 4; }) == 0u);
+    assert(ring.pop_front(-1) == 2);
+    assert(ring.pop_front(-1) == 3);
+    assert(ring.pop_front(-1) == 4);
+    assert(ring.pop_front(-1) == -1);
+}
+
+
+void test_too_few_slots() {
+    for (std::size_t slots : {0, 1}) {
+        bool thrown = false;
+        try {
+            f5::tsring_mpmc<int> ring(slots);
+        } catch (std::invalid_argument &) { thrown = true; }
+        assert(thrown);
+    }
+    // The smallest ring still overwrites its oldest item
+    f5::tsring_mpmc<int> ring(2);
+    ring.push_back([]() { return 1; });
+    ring.push_back([]() { return 2; });
+    ring.push_back([]() { return 3; });
+    assert(ring.pop_front(-1) == 2);
+    assert(ring.pop_front(-1) == 3);
+    assert(ring.pop_front(-1) == -1);
+}
+
+
+/// The conditional push has its own name so that swapping a `tsring` for
+/// a lock free ring can't silently change what the predicate sees
+template<typename R, typename = void>
+struct has_conditional_push_back : std::false_type {};
+template<typename R>
+struct has_conditional_push_back<
+        R,
+        std::void_t<decltype(std::declval<R &>().push_back(
+                std::declval<int (*)()>(), std::declval<bool (*)(int)>()))>>
+: std::true_type {};
+static_assert(has_conditional_push_back<f5::tsring<int>>::value);
+static_assert(not has_conditional_push_back<f5::tsring_mpmc<int>>::value);
+
+
+void test_predicate() {
+    f5::tsring_mpmc<int> ring(2);
+    std::vector<int> asked;
+    int made{};
+    auto const only_big = [&asked](int v) {
+        asked.push_back(v);
+        return v > 10;
+    };
+    auto const make = [&made](int v) {
+        return [&made, v]() {
+            ++made;
+            return v;
+        };
+    };
+    ring.push_back_or_discard(make(1), only_big);
+    ring.push_back_or_discard(make(2), only_big);
+    ring.push_back_or_discard(make(3), only_big);
+    ring.push_back_or_discard(make(20), only_big);
+    // The predicate is only asked when full, and sees the new item
+    assert((asked == std::vector<int>{3, 20}));
+    // The item is made even when it is discarded
+    assert(made == 4);
+    assert(ring.pop_front(-1) == 2);
+    assert(ring.pop_front(-1) == 20);
+    assert(ring.pop_front(-1) == -1);
+}
+
+
+void test_threads() {
+    constexpr int producers = 4, items = 20000;
+    f5::tsring_mpmc<int> ring(items * producers);
+    std::vector<std::thread> threads;
+    for (int p{}; p < producers; ++p) {
+        threads.emplace_back([&ring, p]() {
+            for (int n{}; n < items; ++n) {
+                ring.push_back([p, n]() { return p * items + n; });
+            }
+        });
+    }
+    std::atomic<int> consumed{};
+    std::vector<std::atomic<bool>> seen(items * producers);
+    for (int c{}; c < producers; ++c) {
+        threads.emplace_back([&]() {
+            while (consumed.load() < items * producers) {
+                auto const v = ring.pop_front(-1);
+                if (v >= 0) {
+                    assert(not seen[v].exchange(true));
+                    ++consumed;
+                }
+            }
+        });
+    }
+    for (auto &t : threads) t.join();
+    assert(ring.pop_front(-1) == -1);
+}
+
+
+/// The ring is much smaller than the number of items, so producers keep
+/// overwriting while the consumers are taking items
+void test_threads_overwriting() {
+    constexpr int producers = 4, items = 20000;
+    f5::tsring_mpmc<int> ring(16);
+    std::atomic<int> finished{};
+    std::vector<std::thread> threads;
+    for (int p{}; p < producers; ++p) {
+        threads.emplace_back([&ring, &finished, p]() {
+            for (int n{}; n < items; ++n) {
+                ring.push_back([p, n]() { return p * items + n; });
+            }
+            ++finished;
+        });
+    }
+    std::atomic<int> consumed{};
+    std::vector<std::atomic<bool>> seen(items * producers);
+    for (int c{}; c < producers; ++c) {
+        threads.emplace_back([&]() {
+            while (true) {
+                auto const done = finished.load() == producers;
+                auto const v = ring.pop_front(-1);
+                if (v >= 0) {
+                    assert(not seen[v].exchange(true));
+                    ++consumed;
+                } else if (done) {
+                    break;
+                }
+            }
+        });
+    }
+    for (auto &t : threads) t.join();
+    assert(consumed.load() <= items * producers);
+    assert(ring.pop_front(-1) == -1);
+}
+
+
+int main() {
+    test_overwrite();
+    test_too_few_slots();
+    test_predicate();
+    test_threads();
+    test_threads_overwriting();
+    return 0;
+}
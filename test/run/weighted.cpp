@@ -0,0 +1,140 @@
+#include <f5/threading/channel.hpp>
+#include <f5/threading/weighted.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <cassert>
+#include <chrono>
+#include <vector>
+
+
+using limiter_type = f5::boost_asio::weighted_limiter;
+
+
+/// A large job queued behind running work must start before small jobs
+/// that arrive after it, even though they would fit alongside the first
+void test_fairness() {
+    boost::asio::io_service ios;
+    limiter_type limit{ios, 100};
+    std::vector<char> order;
+    limiter_type::token first, large;
+
+    boost::asio::spawn(ios, [&](auto yield) {
+        first = limit.next_job(60, yield);
+        order.push_back('f');
+    });
+    boost::asio::spawn(ios, [&](auto yield) {
+        large = limit.next_job(80, yield);
+        order.push_back('L');
+    });
+    for (int s{}; s < 3; ++s) {
+        boost::asio::spawn(ios, [&](auto yield) {
+            auto small = limit.next_job(10, yield);
+            order.push_back('s');
+        });
+    }
+    boost::asio::spawn(ios, [&](auto yield) {
+        boost::asio::steady_timer timer{ios};
+        timer.expires_after(std::chrono::milliseconds{10});
+        timer.async_wait(yield);
+        assert(order.size() == 1u);
+        first.done();
+        timer.expires_after(std::chrono::milliseconds{10});
+        timer.async_wait(yield);
+        assert(order.size() == 5u);
+        large.done();
+        limit.wait_for_all_outstanding(yield);
+    });
+    ios.run();
+    assert((order == std::vector<char>{'f', 'L', 's', 's', 's'}));
+    assert(limit.outstanding() == 0u);
+}
+
+
+/// Raising the limit starts waiting jobs, and a job heavier than the limit
+/// runs once nothing else is outstanding
+void test_limits() {
+    boost::asio::io_service ios;
+    limiter_type limit{ios, 10};
+    std::vector<limiter_type::token> tokens;
+    boost::asio::spawn(ios, [&](auto yield) {
+        tokens.push_back(limit.next_job(10, yield));
+        tokens.push_back(limit.next_job(10, yield));
+        assert(limit.limit() == 20u);
+        assert(limit.complete_all(tokens.begin(), tokens.end()) == 20u);
+        tokens.push_back(limit.next_job(50, yield));
+        assert(limit.outstanding() == 50u);
+    });
+    boost::asio::spawn(ios, [&](auto yield) {
+        boost::asio::steady_timer timer{ios};
+        timer.expires_after(std::chrono::milliseconds{10});
+        timer.async_wait(yield);
+        assert(limit.outstanding() == 10u);
+        limit.increase_limit(10);
+    });
+    ios.run();
+    tokens.clear();
+    assert(limit.outstanding() == 0u);
+}
+
+
+/// The limiter can back a channel, where each item has a weight of one
+void test_channel() {
+    boost::asio::io_service ios;
+    f5::boost_asio::channel<int, limiter_type> channel{ios, 2};
+    std::vector<int> seen;
+    boost::asio::spawn(ios, [&](auto yield) {
+        for (int n{}; n < 5; ++n) channel.produce(n, yield);
+        std::vector<int> const items{5, 6, 7};
+        channel.produce_many(items, yield);
+    });
+    boost::asio::spawn(ios, [&](auto yield) {
+        while (seen.size() < 8) {
+            for (auto v : channel.consume_many(yield, 8)) {
+                seen.push_back(v);
+            }
+        }
+        channel.wait_for_all_outstanding(yield);
+        assert(channel.size() == 2u);
+    });
+    ios.run();
+    assert((seen == std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7}));
+
+    // Closing the channel stops new items being added
+    channel.close();
+    bool aborted = false;
+    boost::asio::spawn(ios, [&](auto yield) {
+        try {
+            channel.produce(8, yield);
+        } catch (boost::system::system_error &) { aborted = true; }
+    });
+    ios.restart();
+    ios.run();
+    assert(aborted);
+}
+
+
+/// Closing the limiter wakes a coroutine waiting for outstanding jobs
+void test_close_while_draining() {
+    boost::asio::io_service ios;
+    limiter_type limit{ios, 10};
+    bool aborted = false;
+    auto held = limit.try_next_job(5);
+    boost::asio::spawn(ios, [&](auto yield) {
+        try {
+            limit.wait_for_all_outstanding(yield);
+        } catch (boost::system::system_error &) { aborted = true; }
+    });
+    boost::asio::spawn(ios, [&](auto) { limit.close(); });
+    ios.run();
+    assert(aborted);
+    assert(limit.outstanding() == 5u);
+}
+
+
+int main() {
+    test_fairness();
+    test_limits();
+    test_channel();
+    test_close_while_draining();
+    return 0;
+}